@@ -0,0 +1,98 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "LoopbackSplitLink.h"
+#include "sim.h"
+#include <string.h>
+
+// 同じ条件なら毎回同じように失われるように乱数の種は固定
+const static uint32_t RANDOM_SEED = 1;
+
+LoopbackSplitLink::LoopbackSplitLink()
+    : _peer(nullptr), _conditions(), _random(RANDOM_SEED), _stats() {
+}
+
+void LoopbackSplitLink::connect(LoopbackSplitLink &a, LoopbackSplitLink &b) {
+    a._peer = &b;
+    b._peer = &a;
+    a.setConnected(true);
+    b.setConnected(true);
+}
+
+void LoopbackSplitLink::disconnect(LoopbackSplitLink &a, LoopbackSplitLink &b) {
+    a._peer = nullptr;
+    b._peer = nullptr;
+    a._inFlight.clear();
+    b._inFlight.clear();
+    a.setConnected(false);
+    b.setConnected(false);
+}
+
+bool LoopbackSplitLink::send(const uint8_t *frame, size_t size) {
+    if (_peer == nullptr || size > SPLIT_FRAME_MAX_SIZE) {
+        return false;
+    }
+    _stats.sent++;
+    if (_conditions.loss > 0 && std::uniform_real_distribution<double>(0, 1)(_random) < _conditions.loss) {
+        // 送った側からは失われたことは分からない
+        _stats.lost++;
+        return true;
+    }
+    Frame f;
+    f.arrival = sim::now() + _conditions.latency;
+    if (_conditions.jitter > 0) {
+        f.arrival += std::uniform_int_distribution<uint64_t>(0, _conditions.jitter)(_random);
+    }
+    if (_inFlight.empty() == false && f.arrival < _inFlight.back().arrival) {
+        f.arrival = _inFlight.back().arrival;
+    }
+    f.size = size;
+    memcpy(f.data, frame, size);
+    _inFlight.push_back(f);
+    return true;
+}
+
+void LoopbackSplitLink::setConditions(const LinkConditions &conditions) {
+    _conditions = conditions;
+    _random.seed(RANDOM_SEED);
+}
+
+bool LoopbackSplitLink::nextArrival(uint64_t &time) const {
+    if (_inFlight.empty()) {
+        return false;
+    }
+    time = _inFlight.front().arrival;
+    return true;
+}
+
+bool LoopbackSplitLink::deliver(uint64_t time) {
+    if (_inFlight.empty() || _inFlight.front().arrival > time) {
+        return false;
+    }
+    // コールバックの中で送り返されても良いように先に取り出す
+    Frame f = _inFlight.front();
+    _inFlight.pop_front();
+    _peer->received(f.data, f.size);
+    return true;
+}
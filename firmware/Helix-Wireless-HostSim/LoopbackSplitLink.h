@@ -0,0 +1,87 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+// ホストのシミュレーター用のSplitLinkの実装
+// 送ったフレームは仮想時間で遅れて相手側に届き、遅延、揺らぎ、損失を設定できる
+// 無線の代わりに2つを繋いで、マスター側の受け取りから合成までをまとめて動かす
+
+#include "SplitLink.h"
+#include "SplitProtocol.h"
+#include <deque>
+#include <random>
+#include <stdint.h>
+
+// 片方向の届き方
+struct LinkConditions {
+    uint64_t latency; // 送ってから届くまでの時間 (us)
+    uint64_t jitter;  // latencyに0からこの時間までの一様な揺らぎを足す (us)
+    double loss;      // フレームが失われる割合 (0 - 1)
+};
+
+struct LoopbackStats {
+    uint32_t sent; // 送ったフレーム
+    uint32_t lost; // その内失われた物
+};
+
+class LoopbackSplitLink : public SplitLink {
+  public:
+    LoopbackSplitLink();
+
+    // aとbを繋いで両方の接続のコールバックを呼ぶ
+    static void connect(LoopbackSplitLink &a, LoopbackSplitLink &b);
+
+    // 切断して両方の接続のコールバックを呼ぶ、送っている途中のフレームは捨てる
+    static void disconnect(LoopbackSplitLink &a, LoopbackSplitLink &b);
+
+    // 届く時刻を決めて溜めておく、BLEと同じく順番は入れ替わらない
+    bool send(const uint8_t *frame, size_t size) override;
+
+    // このリンクから送るフレームの届き方、乱数も最初からにする
+    void setConditions(const LinkConditions &conditions);
+
+    // 送っている途中のフレームのうち一番早く届く物の仮想時間、無ければfalse
+    bool nextArrival(uint64_t &time) const;
+
+    // time以前に届くフレームを1つ相手側の受け取りのコールバックに渡す、渡したらtrue
+    bool deliver(uint64_t time);
+
+    const LoopbackStats &stats() const {
+        return _stats;
+    }
+
+  private:
+    struct Frame {
+        uint64_t arrival;
+        size_t size;
+        uint8_t data[SPLIT_FRAME_MAX_SIZE];
+    };
+
+    LoopbackSplitLink *_peer;
+    LinkConditions _conditions;
+    std::mt19937 _random;
+    std::deque<Frame> _inFlight;
+    LoopbackStats _stats;
+};
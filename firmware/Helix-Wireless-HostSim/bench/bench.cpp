@@ -0,0 +1,308 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+// キーIDのトレースをapplyToKeymapに流してコストを測るベンチマーク
+//   bench [-n repeat] [-o result.json] [-l latency_us] [-j jitter_us] [-p loss_percent] trace...
+//
+// -l -j -pはスレーブ側のキーを運ぶLoopbackSplitLinkの遅延、揺らぎ、損失 (両方向)
+//
+// トレースファイルは1行1イベントで "<時間(ms)> <+ID(押下) | -ID(リリース)>"、#以降はコメント
+// 測る物
+//   - 1イベントあたりのCPU時間 (キュー経由でapplyToKeymapを呼んで処理が終わるまでの実時間)
+//   - 1キー押下あたりのHIDレポート数
+//   - イベントからHIDレポートが出るまでの仮想時間 (次のイベントまでにレポートが出なかった物は除く)
+//   - 失われたフレーム、マスター側で見つけた抜け、スナップショットの要求、最後にスレーブ側のIDが合っているか
+
+#include "sim.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+struct TraceEvent {
+    uint64_t time; // us
+    uint8_t id;
+    bool pressed;
+};
+
+struct Summary {
+    size_t count;
+    double mean;
+    double p50;
+    double p99;
+    double max;
+};
+
+struct TraceResult {
+    std::string name;
+    size_t events;
+    size_t keystrokes;
+    size_t reports;
+    size_t silentEvents;
+    Summary cpuNs;
+    Summary latencyUs;
+    uint32_t lostFrames;
+    uint32_t gaps;
+    uint32_t resyncRequests;
+    uint32_t watchdogReleases;
+    bool isInSync;
+};
+
+// 余ったタイマー(タップ、マクロなど)を処理させるためにトレースの最後で進める時間
+static const uint64_t DRAIN_TIME = 3000000;
+
+static bool loadTrace(const char *path, std::vector<TraceEvent> &events) {
+    FILE *fp = fopen(path, "r");
+    if (fp == nullptr) {
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        char *comment = strchr(line, '#');
+        if (comment != nullptr) {
+            *comment = '\0';
+        }
+        double ms;
+        char sign;
+        int id;
+        if (sscanf(line, "%lf %c%d", &ms, &sign, &id) != 3) {
+            continue;
+        }
+        if ((sign != '+' && sign != '-') || id <= 0 || id > 255 || ms < 0) {
+            fprintf(stderr, "%s: invalid line: %s", path, line);
+            fclose(fp);
+            return false;
+        }
+        TraceEvent event = {
+            .time = static_cast<uint64_t>(ms * 1000),
+            .id = static_cast<uint8_t>(id),
+            .pressed = (sign == '+'),
+        };
+        events.push_back(event);
+    }
+    fclose(fp);
+    std::stable_sort(events.begin(), events.end(), [](const TraceEvent &a, const TraceEvent &b) {
+        return a.time < b.time;
+    });
+    return true;
+}
+
+static Summary summarize(std::vector<double> samples) {
+    Summary summary = {};
+    summary.count = samples.size();
+    if (samples.empty()) {
+        return summary;
+    }
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (double sample : samples) {
+        sum += sample;
+    }
+    summary.mean = sum / samples.size();
+    summary.p50 = samples[(samples.size() - 1) * 50 / 100];
+    summary.p99 = samples[(samples.size() - 1) * 99 / 100];
+    summary.max = samples.back();
+    return summary;
+}
+
+static std::string traceName(const char *path) {
+    std::string name(path);
+    size_t slash = name.find_last_of('/');
+    if (slash != std::string::npos) {
+        name = name.substr(slash + 1);
+    }
+    size_t dot = name.find_last_of('.');
+    if (dot != std::string::npos) {
+        name = name.substr(0, dot);
+    }
+    return name;
+}
+
+// 1回分トレースを流す、reportIndexには各イベントの直前のレポート数を入れる
+static void replay(const std::vector<TraceEvent> &events, std::vector<double> &cpuNs, std::vector<size_t> *reportIndex) {
+    uint64_t base = sim::now();
+    for (const TraceEvent &event : events) {
+        uint64_t time = base + event.time;
+        if (time > sim::now()) {
+            sim::advance(time - sim::now());
+        }
+        if (reportIndex != nullptr) {
+            reportIndex->push_back(sim::reports().size());
+        }
+        auto start = std::chrono::steady_clock::now();
+        sim::setKey(event.id, event.pressed);
+        auto end = std::chrono::steady_clock::now();
+        cpuNs.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+    }
+    sim::advance(DRAIN_TIME);
+}
+
+static TraceResult run(const char *path, const std::vector<TraceEvent> &events, uint repeat) {
+    TraceResult result = {};
+    result.name = traceName(path);
+    result.events = events.size();
+
+    std::vector<double> cpuNs, latencyUs;
+    std::vector<size_t> reportIndex;
+
+    // 1回目でレポート数とレイテンシを測る
+    sim::clearReports();
+    uint64_t base = sim::now();
+    sim::LinkReport before = sim::linkReport();
+    replay(events, cpuNs, &reportIndex);
+    sim::LinkReport after = sim::linkReport();
+    const std::vector<HidReport> &reports = sim::reports();
+    result.reports = reports.size();
+    result.lostFrames = (after.toMaster.lost + after.toSlave.lost) - (before.toMaster.lost + before.toSlave.lost);
+    result.gaps = after.receiver.gaps - before.receiver.gaps;
+    result.resyncRequests = after.receiver.resyncRequests - before.receiver.resyncRequests;
+    result.watchdogReleases = after.watchdog.releases - before.watchdog.releases;
+    result.isInSync = after.isInSync;
+
+    for (size_t i = 0; i < events.size(); i++) {
+        if (events[i].pressed) {
+            result.keystrokes++;
+        }
+        // 次のイベントまでに出た最初のレポートをこのイベントによる物とする
+        size_t r = reportIndex[i];
+        size_t next = (i + 1 < events.size()) ? reportIndex[i + 1] : reports.size();
+        if (r < next) {
+            latencyUs.push_back(reports[r].time - (base + events[i].time));
+        } else {
+            result.silentEvents++;
+        }
+    }
+
+    // 残りはCPU時間だけ測る
+    for (uint i = 1; i < repeat; i++) {
+        sim::clearReports();
+        replay(events, cpuNs, nullptr);
+    }
+    sim::clearReports();
+
+    result.cpuNs = summarize(cpuNs);
+    result.latencyUs = summarize(latencyUs);
+    return result;
+}
+
+static void writeSummary(FILE *fp, const char *name, const Summary &summary, bool last) {
+    fprintf(fp, "      \"%s\": {\"count\": %zu, \"mean\": %.3f, \"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f}%s\n",
+            name, summary.count, summary.mean, summary.p50, summary.p99, summary.max, last ? "" : ",");
+}
+
+static void writeJson(FILE *fp, const std::vector<TraceResult> &results, uint repeat, const LinkConditions &link) {
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"keymap\": \"%s\",\n", BENCH_KEYMAP_NAME);
+    fprintf(fp, "  \"repeat\": %u,\n", repeat);
+    fprintf(fp, "  \"link\": {\"latency_us\": %llu, \"jitter_us\": %llu, \"loss\": %.4f},\n",
+            static_cast<unsigned long long>(link.latency), static_cast<unsigned long long>(link.jitter), link.loss);
+    fprintf(fp, "  \"traces\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const TraceResult &result = results[i];
+        fprintf(fp, "    {\n");
+        fprintf(fp, "      \"name\": \"%s\",\n", result.name.c_str());
+        fprintf(fp, "      \"events\": %zu,\n", result.events);
+        fprintf(fp, "      \"keystrokes\": %zu,\n", result.keystrokes);
+        fprintf(fp, "      \"reports\": %zu,\n", result.reports);
+        fprintf(fp, "      \"reports_per_keystroke\": %.3f,\n",
+                result.keystrokes ? static_cast<double>(result.reports) / result.keystrokes : 0.0);
+        fprintf(fp, "      \"silent_events\": %zu,\n", result.silentEvents);
+        fprintf(fp, "      \"link_lost_frames\": %u,\n", result.lostFrames);
+        fprintf(fp, "      \"link_gaps\": %u,\n", result.gaps);
+        fprintf(fp, "      \"link_resync_requests\": %u,\n", result.resyncRequests);
+        fprintf(fp, "      \"link_watchdog_releases\": %u,\n", result.watchdogReleases);
+        fprintf(fp, "      \"slave_in_sync\": %s,\n", result.isInSync ? "true" : "false");
+        writeSummary(fp, "cpu_ns_per_event", result.cpuNs, false);
+        writeSummary(fp, "latency_us", result.latencyUs, true);
+        fprintf(fp, "    }%s\n", (i + 1 == results.size()) ? "" : ",");
+    }
+    fprintf(fp, "  ]\n");
+    fprintf(fp, "}\n");
+}
+
+static void usage() {
+    fprintf(stderr, "usage: bench [-n repeat] [-o result.json] [-l latency_us] [-j jitter_us] [-p loss_percent] trace...\n");
+}
+
+int main(int argc, char *argv[]) {
+    uint repeat = 100;
+    const char *output = nullptr;
+    LinkConditions link = {};
+    std::vector<const char *> paths;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            repeat = max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            link.latency = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            link.jitter = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            link.loss = atof(argv[++i]) / 100;
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 1;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.empty()) {
+        usage();
+        return 1;
+    }
+
+    sim::begin();
+    sim::setLinkConditions(link);
+
+    std::vector<TraceResult> results;
+    for (const char *path : paths) {
+        std::vector<TraceEvent> events;
+        if (loadTrace(path, events) == false) {
+            fprintf(stderr, "failed to load %s\n", path);
+            return 1;
+        }
+        results.push_back(run(path, events, repeat));
+    }
+
+    printf("%-12s %7s %8s %9s %11s %11s %11s %6s %7s\n", "trace", "events", "reports", "rep/key", "cpu ns/ev", "cpu p99", "lat p99 us", "lost", "in sync");
+    for (const TraceResult &result : results) {
+        printf("%-12s %7zu %8zu %9.3f %11.1f %11.1f %11.1f %6u %7s\n", result.name.c_str(), result.events, result.reports,
+               result.keystrokes ? static_cast<double>(result.reports) / result.keystrokes : 0.0,
+               result.cpuNs.mean, result.cpuNs.p99, result.latencyUs.p99, result.lostFrames, result.isInSync ? "yes" : "NO");
+    }
+
+    if (output != nullptr) {
+        FILE *fp = fopen(output, "w");
+        if (fp == nullptr) {
+            fprintf(stderr, "failed to open %s\n", output);
+            return 1;
+        }
+        writeJson(fp, results, repeat, link);
+        fclose(fp);
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+// ベンチマーク用のキーマップ
+// 全てのキーで8レイヤーを使い、同時押し、シーケンス、タップ系のコマンドも多めに定義して
+// applyToKeymapの一番重いケースを測る (keymap.cppにKEYMAP_OVERRIDEとしてincludeされる)
+
+static const int LOWER = 1;
+static const int RAISE = 2;
+
+static Key keymap[] = {
+    {1, L(NK(_GRAVE), CK(_SHIFT, _GRAVE), NK(_2), NK(_F2), CK(_CTRL, _GRAVE), CK(_ALT, _GRAVE), CK(_GUI, _GRAVE), MP(NK(_GRAVE), CK(_SHIFT, _GRAVE)))},
+    {2, L(NK(_1), CK(_SHIFT, _1), NK(_3), NK(_F3), CK(_CTRL, _1), CK(_ALT, _1), CK(_GUI, _1), MP(NK(_1), CK(_SHIFT, _1)))},
+    {3, L(NK(_2), CK(_SHIFT, _2), NK(_4), NK(_F4), CK(_CTRL, _2), CK(_ALT, _2), CK(_GUI, _2), MP(NK(_2), CK(_SHIFT, _2)))},
+    {4, L(NK(_3), CK(_SHIFT, _3), NK(_5), NK(_F5), CK(_CTRL, _3), CK(_ALT, _3), CK(_GUI, _3), MP(NK(_3), CK(_SHIFT, _3)))},
+    {5, L(NK(_4), CK(_SHIFT, _4), NK(_6), NK(_F6), CK(_CTRL, _4), CK(_ALT, _4), CK(_GUI, _4), MP(NK(_4), CK(_SHIFT, _4)))},
+    {6, L(NK(_5), CK(_SHIFT, _5), NK(_7), NK(_F7), CK(_CTRL, _5), CK(_ALT, _5), CK(_GUI, _5), MP(NK(_5), CK(_SHIFT, _5)))},
+    {7, L(NK(_6), CK(_SHIFT, _6), NK(_8), NK(_F8), CK(_CTRL, _6), CK(_ALT, _6), CK(_GUI, _6), MP(NK(_6), CK(_SHIFT, _6)))},
+    {8, L(NK(_7), CK(_SHIFT, _7), NK(_9), NK(_F9), CK(_CTRL, _7), CK(_ALT, _7), CK(_GUI, _7), MP(NK(_7), CK(_SHIFT, _7)))},
+    {9, L(NK(_8), CK(_SHIFT, _8), NK(_0), NK(_F10), CK(_CTRL, _8), CK(_ALT, _8), CK(_GUI, _8), MP(NK(_8), CK(_SHIFT, _8)))},
+    {10, L(NK(_9), CK(_SHIFT, _9), NK(_1), NK(_F11), CK(_CTRL, _9), CK(_ALT, _9), CK(_GUI, _9), MP(NK(_9), CK(_SHIFT, _9)))},
+    {11, L(NK(_0), CK(_SHIFT, _0), NK(_2), NK(_F12), CK(_CTRL, _0), CK(_ALT, _0), CK(_GUI, _0), MP(NK(_0), CK(_SHIFT, _0)))},
+    {12, L(NK(_DELETE), CK(_SHIFT, _DELETE), NK(_3), NK(_F1), CK(_CTRL, _DELETE), CK(_ALT, _DELETE), CK(_GUI, _DELETE), MP(NK(_DELETE), CK(_SHIFT, _DELETE)))},
+
+    {13, L(NK(_TAB), CK(_SHIFT, _TAB), NK(_4), NK(_F2), CK(_CTRL, _TAB), CK(_ALT, _TAB), CK(_GUI, _TAB), MP(NK(_TAB), CK(_SHIFT, _TAB)))},
+    {14, L(NK(_Q), CK(_SHIFT, _Q), NK(_5), NK(_F3), CK(_CTRL, _Q), CK(_ALT, _Q), CK(_GUI, _Q), MP(NK(_Q), CK(_SHIFT, _Q)))},
+    {15, L(NK(_W), CK(_SHIFT, _W), NK(_6), NK(_F4), MS_MOV(0, -8), CK(_ALT, _W), CK(_GUI, _W), MP(NK(_W), CK(_SHIFT, _W)))},
+    {16, L(NK(_E), CK(_SHIFT, _E), NK(_7), NK(_F5), MS_SCR(1), CK(_ALT, _E), CK(_GUI, _E), MP(NK(_E), CK(_SHIFT, _E)))},
+    {17, L(NK(_R), CK(_SHIFT, _R), NK(_8), NK(_F6), MS_SPD(50), CK(_ALT, _R), CK(_GUI, _R), MP(NK(_R), CK(_SHIFT, _R)))},
+    {18, L(NK(_T), CK(_SHIFT, _T), NK(_9), NK(_F7), CK(_CTRL, _T), CK(_ALT, _T), CK(_GUI, _T), MP(NK(_T), CK(_SHIFT, _T)))},
+    {19, L(NK(_Y), CK(_SHIFT, _Y), NK(_0), NK(_F8), CK(_CTRL, _Y), CK(_ALT, _Y), CK(_GUI, _Y), MP(NK(_Y), CK(_SHIFT, _Y)))},
+    {20, L(NK(_U), CK(_SHIFT, _U), NK(_1), NK(_F9), CK(_CTRL, _U), CK(_ALT, _U), CK(_GUI, _U), MP(NK(_U), CK(_SHIFT, _U)))},
+    {21, L(NK(_I), CK(_SHIFT, _I), NK(_2), NK(_F10), CK(_CTRL, _I), CK(_ALT, _I), CK(_GUI, _I), MP(NK(_I), CK(_SHIFT, _I)))},
+    {22, L(NK(_O), CK(_SHIFT, _O), NK(_3), NK(_F11), CK(_CTRL, _O), CK(_ALT, _O), CK(_GUI, _O), MP(NK(_O), CK(_SHIFT, _O)))},
+    {23, L(NK(_P), CK(_SHIFT, _P), NK(_4), NK(_F12), CK(_CTRL, _P), CK(_ALT, _P), CK(_GUI, _P), MP(NK(_P), CK(_SHIFT, _P)))},
+    {24, L(NK(_BACKSPACE), CK(_SHIFT, _BACKSPACE), NK(_5), NK(_F1), CK(_CTRL, _BACKSPACE), CK(_ALT, _BACKSPACE), CK(_GUI, _BACKSPACE), MP(NK(_BACKSPACE), CK(_SHIFT, _BACKSPACE)))},
+
+    {25, MT(_CTRL, _ESCAPE)},
+    {26, L(NK(_A), CK(_SHIFT, _A), NK(_7), NK(_F3), MS_CLK(_LEFT_BUTTON), CK(_ALT, _A), CK(_GUI, _A), MP(NK(_A), CK(_SHIFT, _A)))},
+    {27, L(NK(_S), CK(_SHIFT, _S), NK(_8), NK(_F4), MS_MOV(-8, 0), CK(_ALT, _S), CK(_GUI, _S), MP(NK(_S), CK(_SHIFT, _S)))},
+    {28, L(NK(_D), CK(_SHIFT, _D), NK(_9), NK(_F5), MS_MOV(0, 8), CK(_ALT, _D), CK(_GUI, _D), MP(NK(_D), CK(_SHIFT, _D)))},
+    {29, L(NK(_F), CK(_SHIFT, _F), NK(_0), NK(_F6), MS_MOV(8, 0), CK(_ALT, _F), CK(_GUI, _F), MP(NK(_F), CK(_SHIFT, _F)))},
+    {30, L(NK(_G), CK(_SHIFT, _G), NK(_1), NK(_F7), MS_CLK(_RIGHT_BUTTON), CK(_ALT, _G), CK(_GUI, _G), MP(NK(_G), CK(_SHIFT, _G)))},
+    {31, L(NK(_H), CK(_SHIFT, _H), NK(_2), NK(_F8), CK(_CTRL, _H), CK(_ALT, _H), CK(_GUI, _H), MP(NK(_H), CK(_SHIFT, _H)))},
+    {32, L(NK(_J), CK(_SHIFT, _J), NK(_3), NK(_F9), CK(_CTRL, _J), CK(_ALT, _J), CK(_GUI, _J), MP(NK(_J), CK(_SHIFT, _J)))},
+    {33, L(NK(_K), CK(_SHIFT, _K), NK(_4), NK(_F10), CK(_CTRL, _K), CK(_ALT, _K), CK(_GUI, _K), MP(NK(_K), CK(_SHIFT, _K)))},
+    {34, L(NK(_L), CK(_SHIFT, _L), NK(_5), NK(_F11), CK(_CTRL, _L), CK(_ALT, _L), CK(_GUI, _L), MP(NK(_L), CK(_SHIFT, _L)))},
+    {35, L(NK(_SEMICOLON), CK(_SHIFT, _SEMICOLON), NK(_6), NK(_F12), CK(_CTRL, _SEMICOLON), CK(_ALT, _SEMICOLON), CK(_GUI, _SEMICOLON), MP(NK(_SEMICOLON), CK(_SHIFT, _SEMICOLON)))},
+    {36, L(NK(_QUOTE), CK(_SHIFT, _QUOTE), NK(_7), NK(_F1), CK(_CTRL, _QUOTE), CK(_ALT, _QUOTE), CK(_GUI, _QUOTE), MP(NK(_QUOTE), CK(_SHIFT, _QUOTE)))},
+
+    {37, L(MO(_SHIFT), _______, _______, _______, _______, _______, _______, _______)},
+    {38, L(NK(_Z), CK(_SHIFT, _Z), NK(_9), NK(_F3), CK(_CTRL, _Z), CK(_ALT, _Z), CK(_GUI, _Z), MP(NK(_Z), CK(_SHIFT, _Z)))},
+    {39, L(NK(_X), CK(_SHIFT, _X), NK(_0), NK(_F4), CK(_CTRL, _X), CK(_ALT, _X), CK(_GUI, _X), MP(NK(_X), CK(_SHIFT, _X)))},
+    {40, L(NK(_C), CK(_SHIFT, _C), NK(_1), NK(_F5), MS_SCR(-1), CK(_ALT, _C), CK(_GUI, _C), MP(NK(_C), CK(_SHIFT, _C)))},
+    {41, L(NK(_V), CK(_SHIFT, _V), NK(_2), NK(_F6), MS_SPD(200), CK(_ALT, _V), CK(_GUI, _V), MP(NK(_V), CK(_SHIFT, _V)))},
+    {42, L(NK(_B), CK(_SHIFT, _B), NK(_3), NK(_F7), CK(_CTRL, _B), CK(_ALT, _B), CK(_GUI, _B), MP(NK(_B), CK(_SHIFT, _B)))},
+    {43, L(NK(_BRACKET_LEFT), CK(_SHIFT, _BRACKET_LEFT), NK(_4), NK(_F8), CK(_CTRL, _BRACKET_LEFT), CK(_ALT, _BRACKET_LEFT), CK(_GUI, _BRACKET_LEFT), MP(NK(_BRACKET_LEFT), CK(_SHIFT, _BRACKET_LEFT)))},
+    {44, L(NK(_BRACKET_RIGHT), CK(_SHIFT, _BRACKET_RIGHT), NK(_5), NK(_F9), CK(_CTRL, _BRACKET_RIGHT), CK(_ALT, _BRACKET_RIGHT), CK(_GUI, _BRACKET_RIGHT), MP(NK(_BRACKET_RIGHT), CK(_SHIFT, _BRACKET_RIGHT)))},
+    {45, L(NK(_N), CK(_SHIFT, _N), NK(_6), NK(_F10), CK(_CTRL, _N), CK(_ALT, _N), CK(_GUI, _N), MP(NK(_N), CK(_SHIFT, _N)))},
+    {46, L(NK(_M), CK(_SHIFT, _M), NK(_7), NK(_F11), CK(_CTRL, _M), CK(_ALT, _M), CK(_GUI, _M), MP(NK(_M), CK(_SHIFT, _M)))},
+    {47, L(NK(_COMMA), CK(_SHIFT, _COMMA), NK(_8), NK(_F12), CK(_CTRL, _COMMA), CK(_ALT, _COMMA), CK(_GUI, _COMMA), MP(NK(_COMMA), CK(_SHIFT, _COMMA)))},
+    {48, L(NK(_PERIOD), CK(_SHIFT, _PERIOD), NK(_9), NK(_F1), CK(_CTRL, _PERIOD), CK(_ALT, _PERIOD), CK(_GUI, _PERIOD), MP(NK(_PERIOD), CK(_SHIFT, _PERIOD)))},
+
+    {49, L(NK(_SLASH), CK(_SHIFT, _SLASH), NK(_0), NK(_F2), CK(_CTRL, _SLASH), CK(_ALT, _SLASH), CK(_GUI, _SLASH), MP(NK(_SLASH), CK(_SHIFT, _SLASH)))},
+    {50, MT(_SHIFT, _ENTER)},
+    {51, SEQ_MODE},
+    {52, OSL(5)},
+    {53, L(MO(_ALT), _______, _______, _______, _______, _______, _______, _______)},
+    {54, L(MO(_GUI), _______, _______, _______, _______, _______, _______, _______)},
+    {55, LT(3, _INT5)},
+    {56, SL(LOWER)},
+    {57, L(NK(_SPACE), CK(_SHIFT, _SPACE), NK(_8), NK(_F10), CK(_CTRL, _SPACE), CK(_ALT, _SPACE), CK(_GUI, _SPACE), MP(NK(_SPACE), CK(_SHIFT, _SPACE)))},
+    {58, L(NK(_SPACE), CK(_SHIFT, _SPACE), NK(_9), NK(_F11), CK(_CTRL, _SPACE), CK(_ALT, _SPACE), CK(_GUI, _SPACE), MP(NK(_SPACE), CK(_SHIFT, _SPACE)))},
+    {59, SL(RAISE)},
+    {60, LT(4, _INT4)},
+    {61, L(NK(_ARROW_LEFT), CK(_SHIFT, _ARROW_LEFT), NK(_2), NK(_F2), CK(_CTRL, _ARROW_LEFT), CC(_PREV), CK(_GUI, _ARROW_LEFT), MP(NK(_ARROW_LEFT), CK(_SHIFT, _ARROW_LEFT)))},
+    {62, L(NK(_ARROW_DOWN), CK(_SHIFT, _ARROW_DOWN), NK(_3), NK(_F3), CK(_CTRL, _ARROW_DOWN), CC(_VOLUME_DOWN), CK(_GUI, _ARROW_DOWN), MP(NK(_ARROW_DOWN), CK(_SHIFT, _ARROW_DOWN)))},
+    {63, L(NK(_ARROW_UP), CK(_SHIFT, _ARROW_UP), NK(_4), NK(_F4), CK(_CTRL, _ARROW_UP), CC(_VOLUME_UP), CK(_GUI, _ARROW_UP), MP(NK(_ARROW_UP), CK(_SHIFT, _ARROW_UP)))},
+    {64, L(NK(_ARROW_RIGHT), CK(_SHIFT, _ARROW_RIGHT), NK(_5), NK(_F5), CK(_CTRL, _ARROW_RIGHT), CC(_NEXT), CK(_GUI, _ARROW_RIGHT), MP(NK(_ARROW_RIGHT), CK(_SHIFT, _ARROW_RIGHT)))},
+};
+
+static SimultaneousKey simultaneousKeymap[] = {
+    {{51, 56, 59}, TOP(2000, NOP, RESET)},
+    {{56, 59}, SL(6)},
+    {{55, 60}, SL(7)},
+    {{26, 27}, NK(_ESCAPE)},
+    {{27, 28}, NK(_TAB)},
+    {{28, 29}, NK(_ENTER)},
+    {{29, 30}, NK(_BACKSPACE)},
+    {{31, 32}, NK(_DELETE)},
+    {{32, 33}, CK(_SHIFT, _9)},
+    {{33, 34}, CK(_SHIFT, _0)},
+    {{34, 35}, CK(_CTRL, _Z)},
+    {{14, 15, 16}, CK(_CTRL, _X)},
+    {{15, 16, 17}, CK(_CTRL, _C)},
+    {{16, 17, 18}, CK(_CTRL, _V)},
+    {{38, 39, 40, 41}, TL(6)},
+    {{45, 46, 47, 48, 49}, TL(7)},
+};
+
+static SequenceKey sequenceKeymap[] = {
+    {{26, 27}, CK(_CTRL, _A)},
+    {{27, 28}, CK(_CTRL, _S)},
+    {{40, 41}, CK(_CTRL | _SHIFT, _C)},
+    {{14, 15, 16}, MACRO(T(_Q), T(_W), T(_E))},
+    {{19, 20, 21, 22}, MACRO(D(_SHIFT), T(_Y), U(_SHIFT), T(_U))},
+    {{31, 32, 33, 34, 35}, CK(_GUI, _H)},
+    {{1, 2}, TL(6)},
+    {{11, 12}, TL(7)},
+};
@@ -0,0 +1,407 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+// シミュレーターで確かめる動作、全部通れば0で終わる
+
+#include "ClockSync.h"
+#include "ConnectionEventMonitor.h"
+#include "Debouncer.h"
+#include "HidWrapper.h"
+#include "KeyStateMailbox.h"
+#include "LinkManager.h"
+#include "SplitProtocol.h"
+#include "Timer.h"
+#include "config.h"
+#include "sim.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+static void expect(bool condition, const char *name) {
+    if (condition == false) {
+        printf("FAIL: %s\n", name);
+        failures++;
+    }
+}
+
+// キーボードのレポートが順番にmodifier、keycode[0]の通りか
+struct KeyboardReport {
+    uint8_t modifier;
+    uint8_t keycode;
+};
+
+static bool isReported(const std::vector<HidReport> &reports, const KeyboardReport *expected, size_t count) {
+    if (reports.size() != count) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (reports[i].type != HidReport::KEYBOARD ||
+            reports[i].modifier != expected[i].modifier ||
+            reports[i].keycode[0] != expected[i].keycode) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// loopが起きる前に押されているキーが離されて押し直された時も、離したレポートを送ってから押したレポートを送る
+static void checkReleaseThenPress() {
+    sim::setKey(16, true);
+    sim::advance(20000);
+    sim::clearReports();
+    sim::queueKey(16, false);
+    sim::queueKey(16, true);
+    sim::advance(20000);
+    const KeyboardReport expected[] = {{0x00, 0x00}, {0x00, 0x08}};
+    expect(isReported(sim::reports(), expected, 2), "release then press of a held key");
+
+    sim::setKey(16, false);
+    sim::advance(20000);
+    sim::setKey(37, true);
+    sim::advance(20000);
+    sim::clearReports();
+    sim::queueKey(37, false);
+    sim::queueKey(37, true);
+    sim::advance(20000);
+    const KeyboardReport expectedModifier[] = {{0x00, 0x00}, {0x02, 0x00}};
+    expect(isReported(sim::reports(), expectedModifier, 2), "release then press of a held modifier");
+
+    sim::setKey(37, false);
+    sim::advance(20000);
+    sim::clearReports();
+}
+
+// まとめている間に同じキーを押して離して押しても、3回とも送る
+static void checkPressReleasePress() {
+    BLEHidAdafruit blehid;
+    blehid.begin();
+    HidWrapper hid;
+    hid.init(blehid);
+
+    hid.beginBatch();
+    hid.setKey(0x08);
+    hid.sendKeyReportIfChanged();
+    hid.unsetKey(0x08);
+    hid.sendKeyReportIfChanged();
+    hid.setKey(0x08);
+    hid.sendKeyReportIfChanged();
+    hid.endBatch();
+    const KeyboardReport expected[] = {{0x00, 0x08}, {0x00, 0x00}, {0x00, 0x08}};
+    expect(isReported(blehid.reports, expected, 3), "press, release and press of a key in one batch");
+
+    blehid.reports.clear();
+    hid.beginBatch();
+    hid.unsetKey(0x08);
+    hid.sendKeyReportIfChanged();
+    hid.setModifier(Modifier::LEFTSHIFT);
+    hid.sendKeyReportIfChanged();
+    hid.unsetModifier(Modifier::LEFTSHIFT);
+    hid.sendKeyReportIfChanged();
+    hid.setModifier(Modifier::LEFTSHIFT);
+    hid.sendKeyReportIfChanged();
+    hid.endBatch();
+    const KeyboardReport expectedModifier[] = {{0x02, 0x00}, {0x00, 0x00}, {0x02, 0x00}};
+    expect(isReported(blehid.reports, expectedModifier, 3), "press, release and press of a modifier in one batch");
+}
+
+// 期限が来た時に、それまでに送られたレポートの数を覚えておくタイマー
+class ReportCountTimer : public Timer {
+  public:
+    ReportCountTimer(uint ms) : Timer(ms, false) {
+    }
+
+    void start() {
+        startTimer();
+    }
+
+    void onTimer() override {
+        reportCount = sim::reports().size();
+        isFired = true;
+    }
+
+    size_t reportCount = 0;
+    bool isFired = false;
+};
+
+// SPLIT_REORDER_WINDOWで待たせているマスター側の変化より後が期限のタイマーは、その変化を処理してから発火させる
+static void checkTimerAfterHeldChange() {
+    static_assert(SPLIT_REORDER_WINDOW > 2, "build check.cpp with SPLIT_REORDER_WINDOW");
+    // Timerは止めずに破棄できないのでstaticにしておく
+    static ReportCountTimer timer(SPLIT_REORDER_WINDOW);
+    timer.start();
+    // タイマーの期限の2ms前に押す、loopに返されるのは期限の後
+    sim::advance((SPLIT_REORDER_WINDOW - 2) * 1000);
+    sim::setKey(16, true);
+    sim::advance(20000);
+    expect(timer.isFired && timer.reportCount == 1, "timer fires after an earlier held change");
+
+    sim::setKey(16, false);
+    sim::advance(20000);
+    sim::clearReports();
+}
+
+// 読まれる前の書き込みはまとめられ、最初と最後の変化の時刻と途中で押して離したキーが残る
+static void checkKeyStateMailbox() {
+    KeyStateMailbox mailbox;
+    KeyState state;
+    expect(mailbox.read(state) == false && mailbox.hasUpdate() == false, "empty mailbox");
+
+    mailbox.publish(0x1, 100);
+    mailbox.publish(0x3, 200);
+    expect(mailbox.hasUpdate() && mailbox.mergeCount() == 1, "merged publish counted");
+    expect(mailbox.read(state) && state.pressed == 0x3 && state.changed == 0x3 && state.bounced == 0 &&
+               state.firstChangeTime == 100 && state.time == 200,
+           "merged state keeps first and last change time");
+    expect(mailbox.read(state) == false && mailbox.hasUpdate() == false, "no update after read");
+
+    // 離して押し直したキーは状態が同じでもbouncedに残る
+    mailbox.publish(0x2, 300);
+    mailbox.publish(0x6, 400);
+    mailbox.publish(0x7, 500);
+    expect(mailbox.read(state) && state.pressed == 0x7 && state.changed == 0x5 && state.bounced == 0x1 &&
+               state.firstChangeTime == 300 && state.time == 500,
+           "release and press between reads is bounced");
+    expect(mailbox.mergeCount() == 3, "merge count accumulates");
+}
+
+// スレーブ側から送る変化のフレームと、受け取った側の抜けや壊れたフレームの扱い
+static void checkSplitFrameDecoder() {
+    SplitFrameEncoder encoder;
+    SplitFrameDecoder decoder;
+    uint8_t buf[SPLIT_FRAME_MAX_SIZE];
+
+    // 1つのフレームにまとめた変化は、変化した順番と時刻が残る
+    expect(encoder.addChanges(0x1, 1000) && encoder.addChanges(0x3, 1100) && encoder.addChanges(0x2, 1200),
+           "changes added to a delta frame");
+    size_t size = encoder.encodeDelta(buf);
+    expect(decoder.decode(buf, size) && decoder.frameType() == DELTA_FRAME && decoder.pressed() == 0x2 &&
+               decoder.changeCount() == 3,
+           "delta frame decoded");
+    expect(decoder.changedPressed(0) == 0x1 && decoder.changeTime(0) == 1000 &&
+               decoder.changedPressed(1) == 0x3 && decoder.changeTime(1) == 1100 &&
+               decoder.changedPressed(2) == 0x2 && decoder.changeTime(2) == 1200,
+           "order and time of each change");
+    expect(decoder.takeResyncRequest() == false, "no resync without a gap");
+    expect(encoder.addChanges(0xff, 1300) == false && encoder.hasChanges() == false, "too many changes for a delta frame");
+
+    // 抜けた後のフレームも分かる変化は反映して、全部送ってもらう
+    encoder.addChanges(0x0, 1400);
+    encoder.encodeDelta(buf);
+    encoder.addChanges(0x4, 1500);
+    size = encoder.encodeDelta(buf);
+    expect(decoder.decode(buf, size) && decoder.pressed() == 0x6, "frame after a gap applied");
+    expect(decoder.stats().gaps == 1 && decoder.takeResyncRequest() && decoder.takeResyncRequest() == false,
+           "gap requests a resync once");
+    size = encoder.encodeSnapshot(0x4, 1600, buf);
+    expect(decoder.decode(buf, size) && decoder.pressed() == 0x4 && decoder.stats().snapshots == 1, "snapshot restores the state");
+
+    // 壊れたフレームは捨てる
+    encoder.addChanges(0x5, 1700);
+    size = encoder.encodeDelta(buf);
+    buf[SPLIT_FRAME_HEADER_SIZE] ^= 0x01;
+    expect(decoder.decode(buf, size) == false && decoder.pressed() == 0x4, "corrupted frame dropped");
+    expect(decoder.stats().badFrames == 1 && decoder.takeResyncRequest(), "corrupted frame requests a resync");
+
+    // ハートビートは番号で最後のフレームの抜けを、ハッシュで状態のずれを見つける
+    size = encoder.encodeHeartbeat(buf);
+    expect(decoder.decode(buf, size) && decoder.stats().gaps == 2 && decoder.takeResyncRequest(), "heartbeat finds a lost last frame");
+    size = encoder.encodeSnapshot(0x5, 1800, buf);
+    decoder.decode(buf, size);
+    size = encoder.encodeHeartbeat(buf);
+    expect(decoder.decode(buf, size) && decoder.stats().hashMismatches == 0 && decoder.takeResyncRequest() == false,
+           "heartbeat matches the state");
+    // 届かなかったフレームと同じ番号で別の状態を送った物
+    SplitFrameEncoder other = encoder;
+    other.encodeSnapshot(0x8, 1900, buf);
+    size = encoder.encodeSnapshot(0x5, 1900, buf);
+    decoder.decode(buf, size);
+    size = other.encodeHeartbeat(buf);
+    expect(decoder.decode(buf, size) && decoder.stats().hashMismatches == 1 && decoder.takeResyncRequest(),
+           "heartbeat finds a different state");
+}
+
+// スレーブ側の時計の差と進む速さの差を、時刻合わせのやり取りから推定する
+static void checkClockSync() {
+    // スレーブ側の時計は50ppm速く、無線は片道100カウント、スレーブ側で返すまで10カウント
+    const Timestamp OFFSET = 1000000;
+    const int32_t DRIFT_PPM = 50;
+    auto remote = [&](Timestamp local) {
+        return local + OFFSET + (Timestamp)((int64_t)local * DRIFT_PPM / 1000000);
+    };
+    ClockSync clock;
+    Timestamp local = 0;
+    for (int i = 0; i < 30; i++) {
+        local = msToTimestamp(1000) * i;
+        TimeSyncSample sample;
+        sample.requestTime = local;
+        sample.receiveTime = remote(local + 100);
+        sample.responseTime = sample.receiveTime + 10;
+        clock.addSample(sample, local + 210);
+    }
+    expect(clock.isSynced() && clock.stats().samples == 30, "clock sync samples used");
+    int32_t drift = clock.stats().driftPpm;
+    expect(drift >= DRIFT_PPM - 5 && drift <= DRIFT_PPM + 5, "clock drift estimated");
+    Timestamp now = local + msToTimestamp(500);
+    int32_t error = (int32_t)(clock.toLocal(remote(now)) - now);
+    // 推定が追いつくまでの遅れは、スキャン周期より十分小さければいい
+    expect(error >= -8 && error <= 8, "remote time converted to local time");
+
+    // 往復に時間が掛かりすぎたやり取りは使わない
+    TimeSyncSample late;
+    late.requestTime = now;
+    late.receiveTime = remote(now + msToTimestamp(5));
+    late.responseTime = late.receiveTime + 10;
+    clock.addSample(late, now + msToTimestamp(10));
+    expect(clock.stats().rejected == 1 && clock.stats().samples == 30, "slow exchange rejected");
+}
+
+// スイッチごとのチャタリング除去の方式
+static void checkDebouncer() {
+    // スキャン周期1ms、ビット0はDEFER、ビット1はEAGER、ビット2は押した時だけすぐ確定するASYM
+    const uint32_t PERIOD = 1000;
+    Debouncer debouncer;
+    debouncer.setPolicy(0, DEFER(5), PERIOD);
+    debouncer.setPolicy(1, EAGER(5), PERIOD);
+    debouncer.setPolicy(2, ASYM(0, 5), PERIOD);
+
+    // 押し始めに揺れる
+    expect(debouncer.update(0x7) == 0x6, "eager and asym press confirmed at once");
+    expect(debouncer.update(0x0) == 0 && debouncer.state() == 0x6, "bounce ignored during lockout or release delay");
+    uint64_t changed = 0;
+    int samples = 0;
+    while (changed == 0 && samples < 20) {
+        changed = debouncer.update(0x7);
+        samples++;
+    }
+    expect(changed == 0x1 && samples == 6, "defer press confirmed after the input is stable");
+    for (int i = 0; i < 5; i++) {
+        debouncer.update(0x7);
+    }
+    expect(debouncer.isSettled(), "settled while the input is stable");
+
+    // 離した時はDEFERとASYMが待つ
+    expect(debouncer.update(0x0) == 0x2 && debouncer.state() == 0x5, "eager release confirmed at once");
+    changed = 0;
+    samples = 1;
+    while (changed == 0 && samples < 20) {
+        changed = debouncer.update(0x0);
+        samples++;
+    }
+    expect(changed == 0x5 && samples == 6 && debouncer.state() == 0, "defer and asym release confirmed after the delay");
+}
+
+// PCとの接続の間隔に合わせるスレーブ側との接続の間隔
+static void checkAlignedInterval() {
+    // 整数分の1と整数倍、範囲に入る物が2つあればpreferShortで選ぶ
+    expect(LinkManager::alignedInterval(16, 6, 8, true) == 8, "aligned interval divides the reference");
+    expect(LinkManager::alignedInterval(11, 40, 48, false) == 44, "aligned interval is a multiple of the reference");
+    expect(LinkManager::alignedInterval(24, 6, 8, true) == 6, "shortest aligned interval when preferring short");
+    expect(LinkManager::alignedInterval(24, 6, 8, false) == 8, "longest aligned interval otherwise");
+    expect(LinkManager::alignedInterval(8, 40, 48, true) == 40 &&
+               LinkManager::alignedInterval(8, 40, 48, false) == 48,
+           "preferShort picks among multiples");
+    // 範囲に入る物が無ければ0で合わせない
+    expect(LinkManager::alignedInterval(9, 6, 8, true) == 0, "no aligned interval in the range");
+    expect(LinkManager::alignedInterval(36, 40, 48, false) == 0, "no aligned interval in the idle range");
+    expect(LinkManager::alignedInterval(0, 6, 8, true) == 0, "no aligned interval without a reference");
+    // 既定の範囲ではPCが15msの時だけ合わせられる
+    expect(LinkManager::alignedInterval(12, HOST_LINK_ACTIVE_INTERVAL_MIN, HOST_LINK_ACTIVE_INTERVAL_MAX, true) == 12 &&
+               LinkManager::alignedInterval(12, SPLIT_LINK_ACTIVE_INTERVAL_MIN, SPLIT_LINK_ACTIVE_INTERVAL_MAX, true) == 6,
+           "default active ranges align at 15 ms");
+    expect(LinkManager::alignedInterval(11, SPLIT_LINK_ACTIVE_INTERVAL_MIN, SPLIT_LINK_ACTIVE_INTERVAL_MAX, true) == 0,
+           "default active ranges do not align at 13.75 ms");
+}
+
+// 仮想時間のusの時刻
+static Timestamp usToTicks(uint64_t us) {
+    return (Timestamp)((us * TIMESTAMP_FREQUENCY + 500000) / 1000000);
+}
+
+// 無線の動作の通知から、接続ごとの接続イベントの格子を追う
+static void checkConnectionEventMonitor() {
+    const uint64_t START = 1000000;
+    // 7.5msの接続だけ、2回目の通知で格子に乗り、来なかった点は飛ばされた接続イベント
+    ConnectionEventMonitor monitor;
+    monitor.setInterval(0, 6);
+    for (int i = 0; i < 10; i++) {
+        if (i != 5) {
+            monitor.notified(usToTicks(START + i * 7500));
+        }
+    }
+    expect(monitor.stats(0).events == 8 && monitor.stats(0).skipped == 1 && monitor.stats(0).collisions == 0,
+           "connection events on the lattice and a skipped one");
+
+    // 格子から1msずれたら乗らなくなり、8回続けて来なければ探し直して新しい格子に乗る
+    for (int i = 10; i < 30; i++) {
+        monitor.notified(usToTicks(START + i * 7500 + 1000));
+    }
+    expect(monitor.stats(0).lockLosses == 1, "lock lost after the lattice slips");
+    expect(monitor.stats(0).events > 8, "lattice acquired again after a slip");
+    uint32_t events = monitor.stats(0).events;
+    monitor.notified(usToTicks(START + 30 * 7500 + 1000));
+    expect(monitor.stats(0).events == events + 1, "events counted on the new lattice");
+
+    // 15msと7.5msの接続の接続イベントが1msしか離れていなければ重なる予定
+    ConnectionEventMonitor colliding;
+    colliding.setInterval(0, 12);
+    colliding.setInterval(1, 6);
+    // 3.75ms離れていれば重ならない
+    ConnectionEventMonitor separated;
+    separated.setInterval(0, 12);
+    separated.setInterval(1, 6);
+    for (int i = 0; i < 20; i++) {
+        uint64_t time = START + i * 15000;
+        colliding.notified(usToTicks(time));
+        colliding.notified(usToTicks(time + 1000));
+        colliding.notified(usToTicks(time + 7500));
+        separated.notified(usToTicks(time));
+        separated.notified(usToTicks(time + 3750));
+        separated.notified(usToTicks(time + 7500));
+    }
+    expect(colliding.stats(0).collisions > 0 && colliding.stats(1).collisions > 0, "collisions of close connection events");
+    expect(colliding.stats(0).skipped == 0 && colliding.stats(1).skipped == 0, "colliding events are not skipped");
+    expect(separated.stats(0).collisions == 0 && separated.stats(1).collisions == 0, "no collisions of separated events");
+    expect(separated.stats(0).events > 15 && separated.stats(1).events > 30, "both lattices tracked");
+}
+
+int main() {
+    sim::begin();
+
+    checkReleaseThenPress();
+    checkPressReleasePress();
+    checkTimerAfterHeldChange();
+    checkKeyStateMailbox();
+    checkSplitFrameDecoder();
+    checkClockSync();
+    checkDebouncer();
+    checkAlignedInterval();
+    checkConnectionEventMonitor();
+
+    if (failures != 0) {
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+// シミュレーターの動作確認用、"Hello"を打ってHIDレポートを表示する
+
+#include "sim.h"
+#include <stdio.h>
+
+static void tap(uint8_t id, uint ms) {
+    sim::setKey(id, true);
+    sim::advance(ms * 1000);
+    sim::setKey(id, false);
+    sim::advance(ms * 1000);
+}
+
+static void printReport(const HidReport &report) {
+    printf("%10llu us  ", static_cast<unsigned long long>(report.time));
+    switch (report.type) {
+    case HidReport::KEYBOARD:
+        printf("keyboard modifier=%02x keys=%02x %02x %02x %02x %02x %02x\n", report.modifier,
+               report.keycode[0], report.keycode[1], report.keycode[2],
+               report.keycode[3], report.keycode[4], report.keycode[5]);
+        break;
+    case HidReport::CONSUMER:
+        printf("consumer usage=%u\n", report.usageCode);
+        break;
+    case HidReport::MOUSE_BUTTON:
+        printf("mouse buttons=%02x\n", report.buttons);
+        break;
+    case HidReport::MOUSE_MOVE:
+        printf("mouse move x=%d y=%d\n", report.x, report.y);
+        break;
+    case HidReport::MOUSE_SCROLL:
+        printf("mouse scroll=%d\n", report.scroll);
+        break;
+    case HidReport::MOUSE_PAN:
+        printf("mouse pan=%d\n", report.pan);
+        break;
+    }
+}
+
+int main() {
+    sim::begin();
+
+    // Shift + h
+    sim::setKey(37, true);
+    sim::advance(20000);
+    tap(31, 40);
+    sim::setKey(37, false);
+    sim::advance(20000);
+    // e l l o
+    tap(16, 40);
+    tap(34, 40);
+    tap(34, 40);
+    tap(22, 40);
+
+    for (const HidReport &report : sim::reports()) {
+        printReport(report);
+    }
+    return 0;
+}
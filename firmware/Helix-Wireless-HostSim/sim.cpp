@@ -0,0 +1,231 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "sim.h"
+#include "Command.h"
+#include "LoopbackSplitLink.h"
+#include "SplitProtocol.h"
+#include "Timer.h"
+#include "keymap.h"
+#include "queues.h"
+#include "slaveSim.h"
+#include "splitReceiver.h"
+
+static BLEHidAdafruit blehid;
+// 押されているID、両側のkeyScanTaskが持っている物の代わり
+static uint64_t scanIDs = 0;
+static uint64_t bleIDs = 0;
+
+// 無線の代わりにスレーブ側とマスター側を繋ぐ、スレーブ側はsplitSenderがそのまま送り、マスター側はsplitReceiverがそのまま受け取る
+static LoopbackSplitLink slaveEnd;
+static LoopbackSplitLink masterEnd;
+
+// スレーブ側の時計のマスター側とのずれ
+static int64_t slaveClockOffset = 0; // us
+static int32_t slaveClockDrift = 0;  // ppm
+
+static Timestamp slaveTimestamp() {
+    int64_t us = (int64_t)sim::now();
+    us += us * slaveClockDrift / 1000000 + slaveClockOffset;
+    return (Timestamp)((uint64_t)us * TIMESTAMP_FREQUENCY / 1000000);
+}
+
+// 届く時刻が来たフレームを両方向とも全部届ける、返事がすぐ届く場合もあるので無くなるまで繰り返す
+// スレーブ側のloopTaskは受け取ったフレームで起こされたらすぐに返事をする
+static void deliverFrames() {
+    do {
+        while (slaveEnd.deliver(sim::now()) || masterEnd.deliver(sim::now())) {
+        }
+    } while (slaveSim::runLoop());
+}
+
+// マスター側(左手)のIDか
+static bool isMasterID(uint8_t id) {
+    uint8_t col = (id - 1) % 12;
+    return (col < 6) || (id == 43) || (id == 57);
+}
+
+// Helix-Wireless-Master.inoのfireTimers()と同じ
+static void fireTimers(Timestamp time) {
+    Timer *timer;
+    while ((timer = Timer::nextExpired(time)) != nullptr) {
+        Command::setEventTime(timer->deadline());
+        timer->fire();
+    }
+}
+
+// loop()の中でレポートをまとめている間か、まとめる期間の終わり
+static bool isBatching = false;
+static Timestamp windowEnd;
+
+static void endBatch() {
+    isBatching = false;
+    Command::endReportBatch();
+}
+
+// Helix-Wireless-Master.inoのloop()と同じ処理を更新されたメールボックスが無くなるまで行う
+// COALESCING_WINDOWが0でなければ期間が終わるまでレポートをまとめたままにしておき、advance()で期間の終わりに送る
+static void dispatchEvents() {
+    KeyState state;
+    while (receiveKeyState(state, 0)) {
+        if (isBatching == false) {
+            isBatching = true;
+            windowEnd = state.firstChangeTime + msToTimestamp(COALESCING_WINDOW);
+            Command::beginReportBatch();
+        }
+        fireTimers(state.firstChangeTime);
+        applyKeyState(state);
+    }
+    if (isBatching && (int32_t)(windowEnd - currentTimestamp()) <= 0) {
+        endBatch();
+    }
+}
+
+// 時刻がdeadline以上になる最初の仮想時間(us)
+static uint64_t timestampToTime(Timestamp deadline) {
+    return ((uint64_t)deadline * 1000000 + TIMESTAMP_FREQUENCY - 1) / TIMESTAMP_FREQUENCY;
+}
+
+// loop()が次に起きる仮想時間、SPLIT_REORDER_WINDOWで待たせている変化が返せるようになる時か
+// まとめている間は期間の終わり(タイマーも期間の終わりまで待たされる)、そうでなければ次のタイマーの期限
+// (待たせている変化より後が期限のタイマーは、その変化を返した後)
+// フレームが届く時はBLEのタスクが受け取るので、まとめている間でも起きる
+static bool nextWakeTime(uint64_t &time) {
+    bool hasTime = false;
+    auto earlier = [&](uint64_t t) {
+        if (hasTime == false || t < time) {
+            time = t;
+            hasTime = true;
+        }
+    };
+    uint64_t arrival;
+    if (slaveEnd.nextArrival(arrival)) {
+        earlier(arrival);
+    }
+    if (masterEnd.nextArrival(arrival)) {
+        earlier(arrival);
+    }
+    Timestamp deadline;
+    if (nextHeldKeyState(deadline)) {
+        earlier(timestampToTime(deadline));
+    }
+    if (isBatching) {
+        earlier(timestampToTime(windowEnd));
+    } else if (nextTimerDeadline(deadline)) {
+        earlier(timestampToTime(deadline));
+    }
+    return hasTime;
+}
+
+namespace sim {
+
+void begin() {
+    initQueues();
+    blehid.begin();
+    initKeymap(blehid);
+    startSplitReceiver(masterEnd);
+    slaveSim::begin(slaveEnd, slaveTimestamp);
+    LoopbackSplitLink::connect(slaveEnd, masterEnd);
+    deliverFrames();
+}
+
+void queueKey(uint8_t id, bool pressed) {
+    uint64_t &ids = isMasterID(id) ? scanIDs : bleIDs;
+    if (pressed) {
+        ids |= keyIDBit(id);
+    } else {
+        ids &= ~keyIDBit(id);
+    }
+    if (isMasterID(id)) {
+        publishKeyState(scanStateMailbox, ids, currentTimestamp());
+    } else {
+        // 接続間隔を知らせていないので、スレーブ側は変化をまとめずにすぐ送る
+        slaveSim::setPressed(ids);
+    }
+    deliverFrames();
+}
+
+void setKey(uint8_t id, bool pressed) {
+    queueKey(id, pressed);
+    dispatchEvents();
+}
+
+void disconnectSlave() {
+    // マスター側は切断で全部離して、接続し直すとスレーブ側に全部送ってもらう
+    LoopbackSplitLink::disconnect(slaveEnd, masterEnd);
+    bleIDs = 0;
+    slaveSim::setPressed(bleIDs);
+    deliverFrames();
+    LoopbackSplitLink::connect(slaveEnd, masterEnd);
+    deliverFrames();
+    dispatchEvents();
+}
+
+void setLinkConditions(const LinkConditions &conditions) {
+    slaveEnd.setConditions(conditions);
+    masterEnd.setConditions(conditions);
+}
+
+void setSlaveClock(int64_t offsetUs, int32_t driftPpm) {
+    slaveClockOffset = offsetUs;
+    slaveClockDrift = driftPpm;
+}
+
+LinkReport linkReport() {
+    LinkReport report;
+    report.toMaster = slaveEnd.stats();
+    report.toSlave = masterEnd.stats();
+    report.receiver = splitLinkStats();
+    report.clock = clockSyncStats();
+    report.watchdog = splitWatchdogStats();
+    report.isInSync = (receivedSlaveIDs() == bleIDs);
+    return report;
+}
+
+void advance(uint64_t us) {
+    uint64_t end = now() + us;
+    while (true) {
+        uint64_t time;
+        if (nextWakeTime(time) == false || time > end) {
+            break;
+        }
+        sleepUntil(time);
+        deliverFrames();
+        dispatchEvents();
+        if (isBatching == false) {
+            fireTimers(timerFiringLimit(currentTimestamp()));
+        }
+    }
+    sleepUntil(end);
+}
+
+const std::vector<HidReport> &reports() {
+    return blehid.reports;
+}
+
+void clearReports() {
+    blehid.reports.clear();
+}
+
+} // namespace sim
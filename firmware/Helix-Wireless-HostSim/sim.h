@@ -0,0 +1,100 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+// マスター側ファームウェアのコア(キーマップ、コマンド、タイマー)をホスト上で動かすためのシミュレーター
+// 時間は仮想時間で、実時間とは関係なく進めることができる
+
+#include "ClockSync.h"
+#include "LoopbackSplitLink.h"
+#include "SplitProtocol.h"
+#include "UInt8Set.h"
+#include "splitReceiver.h"
+#include <bluefruit.h>
+#include <stdint.h>
+#include <vector>
+
+namespace sim {
+
+/*------------------------------------------------------------------*/
+/* Virtual Time (stub/Arduino.cpp)
+ *------------------------------------------------------------------*/
+// 現在の仮想時間 (us)
+uint64_t now();
+
+// 期限がdeadline以前のソフトウェアタイマーのうち一番早い物の期限まで時間を進めてコールバックを呼ぶ
+// 発火するタイマーが無ければfalse
+bool fireNextTimer(uint64_t deadline);
+
+// 期限が来たタイマーのコールバックを呼びながらtimeまで時間を進める
+void sleepUntil(uint64_t time);
+
+// NVIC_SystemResetが呼ばれたか
+bool isResetRequested();
+
+/*------------------------------------------------------------------*/
+/* Master loop (sim.cpp)
+ *------------------------------------------------------------------*/
+// キーマップを初期化する、最初に１回だけ呼ぶ
+void begin();
+
+// IDの押下状態を変える、マスター側のキーはscanStateMailboxに書き込み
+// スレーブ側のキーはスレーブ側のsplitSenderがフレームにしてLoopbackSplitLinkで送り、届いたらsplitReceiverがbleStateMailboxに書き込む
+void setKey(uint8_t id, bool pressed);
+
+// setKeyと同じだがloopでは処理しない、loopが起きる前に続けて変わった時を再現する
+// 次のsetKeyかadvanceでまとめて処理される
+void queueKey(uint8_t id, bool pressed);
+
+// スレーブとの接続が切れた時と同じように、スレーブ側のIDを全部離してから接続し直す
+void disconnectSlave();
+
+// スレーブとマスターの間のフレームの届き方、両方向とも同じにする
+// 最初は遅延も損失も無く、送ったフレームはその場で届く
+void setLinkConditions(const LinkConditions &conditions);
+
+// スレーブ側の時計のずれ、マスター側の時刻合わせで直される
+void setSlaveClock(int64_t offsetUs, int32_t driftPpm);
+
+struct LinkReport {
+    LoopbackStats toMaster;  // スレーブ側から送った物
+    LoopbackStats toSlave;   // マスター側から送った物
+    SplitLinkStats receiver; // マスター側で受け取った物
+    ClockSyncStats clock;
+    SplitWatchdogStats watchdog;
+    bool isInSync; // マスター側が受け取ったスレーブ側のIDが今押されている物と同じか
+};
+
+LinkReport linkReport();
+
+// 仮想時間をus進める、その間に発火したタイマーはその時刻にloopで処理される
+void advance(uint64_t us);
+
+// 記録されたHIDレポート
+const std::vector<HidReport> &reports();
+
+void clearReports();
+
+} // namespace sim
@@ -0,0 +1,69 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "slaveSim.h"
+#include "queues.h"
+#include "splitSender.h"
+
+// keyScanTaskからloopTaskに渡すメールボックス、Helix-Wireless-Slaveのqueues.cppの代わり
+static KeyStateMailbox scanMailbox;
+static Timestamp (*slaveTimestamp)();
+// loopTaskが起こされてからまだ処理していない
+static bool isWoken = false;
+
+void wakeLoopTask() {
+    isWoken = true;
+}
+
+void wakeLoopTaskFromISR(BaseType_t *woken) {
+    isWoken = true;
+}
+
+namespace slaveSim {
+
+void begin(LoopbackSplitLink &link, Timestamp (*now)()) {
+    slaveTimestamp = now;
+    startSplitSender(link, now);
+}
+
+void setPressed(uint64_t pressed) {
+    scanMailbox.publish(pressed, slaveTimestamp());
+    isWoken = true;
+}
+
+// Helix-Wireless-Slave.inoのloop()と同じ、タイマーはマスター側と同じ一覧にあるのでマスター側のloopで発火させる
+bool runLoop() {
+    if (isWoken == false) {
+        return false;
+    }
+    isWoken = false;
+    KeyState state;
+    if (scanMailbox.read(state)) {
+        sendKeyState(state);
+    }
+    processSplitRequests();
+    return true;
+}
+
+} // namespace slaveSim
@@ -22,21 +22,23 @@
   THE SOFTWARE.
 */
 
-#include "Switch.h"
-
-Switch::Switch(int pin, uint8_t id) : _pin(pin), _id(id), _bounce() {}
-
-void Switch::init() {
-    _bounce.attach(_pin);
-    _bounce.interval(DEBOUNCE_DELAY);
-}
-
-void Switch::update(UInt8Set &ids) {
-    if (_bounce.update()) {
-        if (_bounce.read() == LOW) {
-            ids.add(_id);
-        } else {
-            ids.remove(_id);
-        }
-    }
-}
+#pragma once
+
+// シミュレーターのスレーブ側、Helix-Wireless-SlaveのsplitSender.cppをそのまま動かす
+// スレーブ側のヘッダーはマスター側と同じ名前なので、slaveSim.cppはスレーブ側のフォルダからincludeしてビルドする
+
+#include "LoopbackSplitLink.h"
+#include <stdint.h>
+
+namespace slaveSim {
+
+// linkでマスター側に送る、フレームの時刻はnowで読む、最初に1回だけ呼ぶ
+void begin(LoopbackSplitLink &link, Timestamp (*now)());
+
+// スレーブ側の押されているIDを変える、keyScanTaskと同じくメールボックスに書き込んでloopTaskを起こす
+void setPressed(uint64_t pressed);
+
+// スレーブ側のloopTaskが起こされていたら、変化やマスター側からの要求の返事を送る、何か処理したらtrue
+bool runLoop();
+
+} // namespace slaveSim
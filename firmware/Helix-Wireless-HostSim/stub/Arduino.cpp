@@ -0,0 +1,316 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "sim.h"
+#include "Timestamp.h"
+#include <Arduino.h>
+#include <deque>
+#include <stdio.h>
+#include <vector>
+
+/*------------------------------------------------------------------*/
+/* Virtual Time
+ *------------------------------------------------------------------*/
+static uint64_t currentTime = 0;
+
+static inline uint64_t tick2us(TickType_t ticks) {
+    return static_cast<uint64_t>(ticks) * 1000000 / configTICK_RATE_HZ;
+}
+
+/*------------------------------------------------------------------*/
+/* Software Timer
+ *------------------------------------------------------------------*/
+struct SimTimer {
+    TickType_t period;
+    bool autoReload;
+    void *timerID;
+    TimerCallbackFunction_t callback;
+    bool isActive;
+    uint64_t expiry;
+    uint64_t order; // 期限が同じ場合は先に開始した方から発火させる
+};
+
+// staticな初期化中にxTimerCreateが呼ばれるので関数内staticにしておく
+static std::vector<SimTimer *> &timers() {
+    static std::vector<SimTimer *> list;
+    return list;
+}
+
+static uint64_t startOrder = 0;
+
+static void start(SimTimer *timer) {
+    timer->isActive = true;
+    timer->expiry = currentTime + tick2us(timer->period);
+    timer->order = startOrder++;
+}
+
+static SimTimer *findNextTimer(uint64_t deadline) {
+    SimTimer *next = nullptr;
+    for (SimTimer *timer : timers()) {
+        if (timer->isActive == false || timer->expiry > deadline) {
+            continue;
+        }
+        if (next == nullptr || timer->expiry < next->expiry ||
+            (timer->expiry == next->expiry && timer->order < next->order)) {
+            next = timer;
+        }
+    }
+    return next;
+}
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t autoReload, void *timerID, TimerCallbackFunction_t callback) {
+    SimTimer *timer = new SimTimer();
+    timer->period = period;
+    timer->autoReload = autoReload;
+    timer->timerID = timerID;
+    timer->callback = callback;
+    timers().push_back(timer);
+    return timer;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticksToWait) {
+    start(timer);
+    return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticksToWait) {
+    timer->isActive = false;
+    return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticksToWait) {
+    start(timer);
+    return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t newPeriod, TickType_t ticksToWait) {
+    timer->period = newPeriod;
+    start(timer);
+    return pdPASS;
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer) {
+    return timer->isActive ? pdTRUE : pdFALSE;
+}
+
+void *pvTimerGetTimerID(TimerHandle_t timer) {
+    return timer->timerID;
+}
+
+/*------------------------------------------------------------------*/
+/* Queue
+ *------------------------------------------------------------------*/
+struct SimQueue {
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    std::deque<std::vector<uint8_t>> items;
+};
+
+static void push(QueueHandle_t queue, const void *item) {
+    const uint8_t *p = static_cast<const uint8_t *>(item);
+    queue->items.emplace_back(p, p + queue->itemSize);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    SimQueue *queue = new SimQueue();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait) {
+    if (queue->items.size() >= queue->length) {
+        // シングルスレッドなので待っても誰も取り出さない
+        if (ticksToWait != 0) {
+            fprintf(stderr, "sim: xQueueSend blocked on a full queue (deadlock)\n");
+            abort();
+        }
+        return errQUEUE_FULL;
+    }
+    push(queue, item);
+    return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higherPriorityTaskWoken) {
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item) {
+    queue->items.clear();
+    push(queue, item);
+    return pdPASS;
+}
+
+BaseType_t xQueueOverwriteFromISR(QueueHandle_t queue, const void *item, BaseType_t *higherPriorityTaskWoken) {
+    return xQueueOverwrite(queue, item);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t ticksToWait) {
+    if (queue->items.empty() && ticksToWait != 0) {
+        uint64_t deadline = (ticksToWait == portMAX_DELAY) ? UINT64_MAX : currentTime + tick2us(ticksToWait);
+        while (queue->items.empty() && sim::fireNextTimer(deadline)) {
+        }
+        if (queue->items.empty() && deadline != UINT64_MAX) {
+            currentTime = deadline;
+        }
+    }
+    if (queue->items.empty()) {
+        return pdFALSE;
+    }
+    memcpy(buffer, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    queue->items.clear();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    return queue->items.size();
+}
+
+/*------------------------------------------------------------------*/
+/* Task
+ *------------------------------------------------------------------*/
+struct SimTask {
+    uint32_t notifyCount;
+};
+
+static SimTask loopTask;
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return &loopTask;
+}
+
+TickType_t xTaskGetTickCount() {
+    return static_cast<TickType_t>(currentTime * configTICK_RATE_HZ / 1000000);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    task->notifyCount++;
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait) {
+    if (loopTask.notifyCount == 0 && ticksToWait != 0) {
+        uint64_t deadline = (ticksToWait == portMAX_DELAY) ? UINT64_MAX : currentTime + tick2us(ticksToWait);
+        while (loopTask.notifyCount == 0 && sim::fireNextTimer(deadline)) {
+        }
+        if (loopTask.notifyCount == 0 && deadline != UINT64_MAX) {
+            currentTime = deadline;
+        }
+    }
+    uint32_t count = loopTask.notifyCount;
+    if (count != 0) {
+        loopTask.notifyCount = clearCountOnExit ? 0 : count - 1;
+    }
+    return count;
+}
+
+void vTaskDelay(TickType_t ticksToDelay) {
+    // シングルスレッドなので待っても誰も取り出さない、リングがいっぱいの時に呼ばれる
+    fprintf(stderr, "sim: vTaskDelay called while waiting for the loop task (deadlock)\n");
+    abort();
+}
+
+/*------------------------------------------------------------------*/
+/* sim
+ *------------------------------------------------------------------*/
+namespace sim {
+
+uint64_t now() {
+    return currentTime;
+}
+
+bool fireNextTimer(uint64_t deadline) {
+    SimTimer *timer = findNextTimer(deadline);
+    if (timer == nullptr) {
+        return false;
+    }
+    currentTime = timer->expiry;
+    if (timer->autoReload) {
+        timer->expiry += tick2us(timer->period);
+        timer->order = startOrder++;
+    } else {
+        timer->isActive = false;
+    }
+    timer->callback(timer);
+    return true;
+}
+
+void sleepUntil(uint64_t time) {
+    while (fireNextTimer(time)) {
+    }
+    if (currentTime < time) {
+        currentTime = time;
+    }
+}
+
+} // namespace sim
+
+/*------------------------------------------------------------------*/
+/* Arduino
+ *------------------------------------------------------------------*/
+unsigned long millis() {
+    return currentTime / 1000;
+}
+
+unsigned long micros() {
+    return currentTime;
+}
+
+void delay(uint32_t ms) {
+    sim::sleepUntil(currentTime + static_cast<uint64_t>(ms) * 1000);
+}
+
+void delayMicroseconds(uint32_t us) {
+    sim::sleepUntil(currentTime + us);
+}
+
+/*------------------------------------------------------------------*/
+/* Timestamp (ScanTimer.cppのRTC2の代わり)
+ *------------------------------------------------------------------*/
+Timestamp currentTimestamp() {
+    return static_cast<Timestamp>(currentTime * TIMESTAMP_FREQUENCY / 1000000);
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+static bool resetRequested = false;
+
+void NVIC_SystemReset() {
+    resetRequested = true;
+}
+
+namespace sim {
+
+bool isResetRequested() {
+    return resetRequested;
+}
+
+} // namespace sim
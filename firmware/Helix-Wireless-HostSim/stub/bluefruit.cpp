@@ -0,0 +1,86 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "sim.h"
+#include <bluefruit.h>
+
+AdafruitBluefruit Bluefruit;
+
+void AdafruitBluefruit::clearBonds() {
+}
+
+uint32_t sd_ble_gap_conn_param_update(uint16_t conn_handle, ble_gap_conn_params_t const *p_conn_params) {
+    return NRF_SUCCESS;
+}
+
+bool BLEHidAdafruit::begin() {
+    return true;
+}
+
+HidReport &BLEHidAdafruit::record(HidReport::Type type) {
+    HidReport report = {};
+    report.time = sim::now();
+    report.type = type;
+    reports.push_back(report);
+    return reports.back();
+}
+
+bool BLEHidAdafruit::keyboardReport(uint8_t modifier, uint8_t keycode[6]) {
+    HidReport &report = record(HidReport::KEYBOARD);
+    report.modifier = modifier;
+    memcpy(report.keycode, keycode, sizeof(report.keycode));
+    return true;
+}
+
+bool BLEHidAdafruit::consumerKeyPress(uint16_t usageCode) {
+    record(HidReport::CONSUMER).usageCode = usageCode;
+    return true;
+}
+
+bool BLEHidAdafruit::consumerKeyRelease() {
+    record(HidReport::CONSUMER).usageCode = 0;
+    return true;
+}
+
+bool BLEHidAdafruit::mouseButtonPress(uint8_t buttons) {
+    record(HidReport::MOUSE_BUTTON).buttons = buttons;
+    return true;
+}
+
+bool BLEHidAdafruit::mouseMove(int8_t x, int8_t y) {
+    HidReport &report = record(HidReport::MOUSE_MOVE);
+    report.x = x;
+    report.y = y;
+    return true;
+}
+
+bool BLEHidAdafruit::mouseScroll(int8_t scroll) {
+    record(HidReport::MOUSE_SCROLL).scroll = scroll;
+    return true;
+}
+
+bool BLEHidAdafruit::mousePan(int8_t pan) {
+    record(HidReport::MOUSE_PAN).pan = pan;
+    return true;
+}
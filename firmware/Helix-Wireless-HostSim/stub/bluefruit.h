@@ -0,0 +1,101 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+// ホスト(Linux)ビルド用のBluefruitライブラリの代用品
+// BLEHidAdafruitは送られたレポートを仮想時間のタイムスタンプ付きで記録する
+
+#include <Arduino.h>
+#include <vector>
+
+// 記録されるHIDレポート1個分
+struct HidReport {
+    enum Type : uint8_t {
+        KEYBOARD,
+        CONSUMER,
+        MOUSE_BUTTON,
+        MOUSE_MOVE,
+        MOUSE_SCROLL,
+        MOUSE_PAN,
+    };
+
+    uint64_t time; // 仮想時間 (us)
+    Type type;
+    uint8_t modifier;   // KEYBOARD
+    uint8_t keycode[6]; // KEYBOARD
+    uint16_t usageCode; // CONSUMER
+    uint8_t buttons;    // MOUSE_BUTTON
+    int8_t x;           // MOUSE_MOVE
+    int8_t y;           // MOUSE_MOVE
+    int8_t scroll;      // MOUSE_SCROLL
+    int8_t pan;         // MOUSE_PAN
+};
+
+class BLEHidAdafruit {
+  public:
+    bool begin();
+
+    // Keyboard API
+    bool keyboardReport(uint8_t modifier, uint8_t keycode[6]);
+
+    // Consumer API
+    bool consumerKeyPress(uint16_t usageCode);
+    bool consumerKeyRelease();
+
+    // Mouse API
+    bool mouseButtonPress(uint8_t buttons);
+    bool mouseMove(int8_t x, int8_t y);
+    bool mouseScroll(int8_t scroll);
+    bool mousePan(int8_t pan);
+
+    // 送られたレポート
+    std::vector<HidReport> reports;
+
+  private:
+    HidReport &record(HidReport::Type type);
+};
+
+// SoftDeviceのコネクションパラメーター (LinkManager)
+#define NRF_SUCCESS 0
+#define BLE_CONN_HANDLE_INVALID 0xFFFF
+#define BLE_GAP_CP_MIN_CONN_INTVL_MIN 0x0006
+#define BLE_GAP_CP_MAX_CONN_INTVL_MAX 0x0C80
+
+struct ble_gap_conn_params_t {
+    uint16_t min_conn_interval;
+    uint16_t max_conn_interval;
+    uint16_t slave_latency;
+    uint16_t conn_sup_timeout;
+};
+
+// 接続は無いので何もせずに受け付ける
+uint32_t sd_ble_gap_conn_param_update(uint16_t conn_handle, ble_gap_conn_params_t const *p_conn_params);
+
+class AdafruitBluefruit {
+  public:
+    void clearBonds();
+};
+
+extern AdafruitBluefruit Bluefruit;
@@ -0,0 +1,111 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+// ホスト(Linux)ビルド用のFreeRTOSの代用品
+// シングルスレッドで動かすのでブロッキングは仮想時間を進めることで表現する
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdPASS (pdTRUE)
+#define pdFAIL (pdFALSE)
+#define errQUEUE_FULL ((BaseType_t)0)
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+
+// nRF52のAdafruitコアと同じティックレート
+#define configTICK_RATE_HZ 1024
+#define ms2tick(ms) (((ms) * configTICK_RATE_HZ) / 1000)
+#define tick2ms(tck) (((tck) * 1000) / configTICK_RATE_HZ)
+
+/*------------------------------------------------------------------*/
+/* Queue
+ *------------------------------------------------------------------*/
+typedef struct SimQueue *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait);
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higherPriorityTaskWoken);
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item);
+
+BaseType_t xQueueOverwriteFromISR(QueueHandle_t queue, const void *item, BaseType_t *higherPriorityTaskWoken);
+
+// 空の時にticksToWaitが0以外なら、キューに何か入るまでタイマーを発火させながら仮想時間を進める
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t ticksToWait);
+
+BaseType_t xQueueReset(QueueHandle_t queue);
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+/*------------------------------------------------------------------*/
+/* Task
+ *------------------------------------------------------------------*/
+// シングルスレッドなのでタスクは1つだけ、通知はカウンタで表す
+typedef struct SimTask *TaskHandle_t;
+
+TaskHandle_t xTaskGetCurrentTaskHandle();
+
+TickType_t xTaskGetTickCount();
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+
+// 通知が無い時にticksToWaitが0以外なら、通知が来るまでタイマーを発火させながら仮想時間を進める
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+
+void vTaskDelay(TickType_t ticksToDelay);
+
+// タスクが1つなのでクリティカルセクションは何もしない
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+
+/*------------------------------------------------------------------*/
+/* Software Timer
+ *------------------------------------------------------------------*/
+typedef struct SimTimer *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t timer);
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t autoReload, void *timerID, TimerCallbackFunction_t callback);
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticksToWait);
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticksToWait);
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticksToWait);
+
+// FreeRTOSと同じく停止中のタイマーに対して呼ぶとタイマーが開始される
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t newPeriod, TickType_t ticksToWait);
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer);
+
+void *pvTimerGetTimerID(TimerHandle_t timer);
@@ -0,0 +1,98 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "ClockSync.h"
+
+// 最短の往復からこれ以上遅れたやり取りは、どちらかの向きで接続イベントを待たされているので使わない
+const static uint32_t MAX_EXTRA_DELAY = msToTimestamp(2);
+// 最短の往復の時間を少しずつ伸ばして、接続間隔が変わっても追従できるようにする
+const static uint32_t MIN_DELAY_DECAY = msToTimestamp(1) / 4;
+// driftは基準点からのoffsetの変化で推定する、間隔が短いと時刻の揺れでdriftが大きくぶれる
+const static uint32_t MIN_DRIFT_BASELINE = msToTimestamp(10000);
+// 温度などでdriftが変わるのに追従できるように、この間隔を超えたら基準点を今に移す
+const static uint32_t MAX_DRIFT_BASELINE = msToTimestamp(600000);
+
+void ClockSync::addSample(const TimeSyncSample &sample, Timestamp responseReceivedTime) {
+    // 往復の時間からスレーブ側で処理していた時間を引いた物が、無線で掛かった時間
+    uint32_t delay = (responseReceivedTime - sample.requestTime) - (sample.responseTime - sample.receiveTime);
+    if ((int32_t)delay < 0) {
+        _stats.rejected++;
+        return;
+    }
+    if (_isSynced && delay > _minDelay + MAX_EXTRA_DELAY) {
+        _minDelay += MIN_DELAY_DECAY;
+        _stats.rejected++;
+        return;
+    }
+    if (_isSynced == false || delay < _minDelay) {
+        _minDelay = delay;
+    }
+
+    // 行きと帰りが同じ時間だったとして、t1の時のマスター側の時刻との差
+    uint32_t offset = (sample.receiveTime - sample.requestTime) - delay / 2;
+    Timestamp local = sample.requestTime + delay / 2;
+    if (_isSynced == false) {
+        _offset = offset;
+        _referenceTime = local;
+        _drift = 0;
+        _anchorOffset = offset;
+        _anchorTime = local;
+        _isSynced = true;
+    } else {
+        // 予測とのずれの1/4だけoffsetに反映して揺れを均す
+        int32_t error = (int32_t)(offset - offsetAt(local));
+        _offset = offsetAt(local) + error / 4;
+        _referenceTime = local;
+        uint32_t baseline = local - _anchorTime;
+        if (baseline >= MIN_DRIFT_BASELINE) {
+            _drift = ((int64_t)(int32_t)(_offset - _anchorOffset) << 32) / baseline;
+        }
+        if (baseline >= MAX_DRIFT_BASELINE) {
+            _anchorOffset = _offset;
+            _anchorTime = local;
+        }
+    }
+    _stats.samples++;
+    _stats.delay = delay;
+}
+
+Timestamp ClockSync::toLocal(Timestamp remote) const {
+    // driftはとても小さいので、差を一度だけ引いた時刻でのoffsetで十分
+    return remote - offsetAt(remote - _offset);
+}
+
+void ClockSync::reset() {
+    _isSynced = false;
+}
+
+ClockSyncStats ClockSync::stats() const {
+    ClockSyncStats stats = _stats;
+    stats.driftPpm = (int32_t)((_drift * 1000000) >> 32);
+    return stats;
+}
+
+uint32_t ClockSync::offsetAt(Timestamp local) const {
+    int32_t elapsed = (int32_t)(local - _referenceTime);
+    return _offset + (uint32_t)((elapsed * _drift) >> 32);
+}
@@ -0,0 +1,70 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "SplitProtocol.h"
+#include "Timestamp.h"
+#include <Arduino.h>
+
+struct ClockSyncStats {
+    uint32_t samples;  // 使った時刻合わせのやり取り
+    uint32_t rejected; // 往復に時間が掛かりすぎて捨てたやり取り
+    uint32_t delay;    // 最後に使ったやり取りの往復の時間 (スレーブ側で処理していた時間は除く)
+    int32_t driftPpm;  // スレーブ側の時計がマスター側よりどれだけ速いか (ppm)
+};
+
+// スレーブ側のRTCの時刻をマスター側のRTCの時刻に直す
+// TIME_REQUEST_FRAMEとTIME_RESPONSE_FRAMEのやり取りから2つの時計の差(offset)と進む速さの差(drift)を推定する
+class ClockSync {
+  public:
+    // 1回のやり取りの結果を入れる、responseReceivedTimeはマスター側で受け取った時刻(t3)
+    void addSample(const TimeSyncSample &sample, Timestamp responseReceivedTime);
+
+    // 1回でも時刻合わせができたか
+    bool isSynced() const {
+        return _isSynced;
+    }
+
+    // スレーブ側の時刻をマスター側の時刻に直す、isSyncedの時だけ使える
+    Timestamp toLocal(Timestamp remote) const;
+
+    // 接続し直した時に呼ぶ、スレーブ側が再起動しているかもしれないので最初からやり直す
+    void reset();
+
+    ClockSyncStats stats() const;
+
+  private:
+    // マスター側の時刻localでのスレーブ側の時計との差
+    uint32_t offsetAt(Timestamp local) const;
+
+    bool _isSynced = false;
+    uint32_t _offset = 0;   // _referenceTimeでのスレーブ側の時刻 - マスター側の時刻
+    Timestamp _referenceTime = 0;
+    int64_t _drift = 0;     // マスター側の1カウントあたりに差が変わる量 (2^-32カウント単位)
+    uint32_t _anchorOffset = 0; // driftを推定する基準点
+    Timestamp _anchorTime = 0;
+    uint32_t _minDelay = 0; // 最近のやり取りで一番短い往復の時間
+    ClockSyncStats _stats = {};
+};
@@ -36,8 +36,21 @@ void Command::init(BLEHidAdafruit &blehid) {
     _hid.init(blehid);
 }
 
+void Command::setEventTime(Timestamp time) {
+    _eventTime = time;
+}
+
+void Command::beginReportBatch() {
+    _hid.beginBatch();
+}
+
+void Command::endReportBatch() {
+    _hid.endBatch();
+}
+
 // static member
 Command *Command::_lastPressedCommand = nullptr;
+Timestamp Command::_eventTime = 0;
 HidWrapper Command::_hid;
 LayerController Command::_layerController;
 SpeedController Command::_speedController;
@@ -280,13 +293,13 @@ DetectMultiPress::DetectMultiPress(Command *commands[], uint len)
 }
 
 void DetectMultiPress::onPress() {
-    unsigned long currentMillis = millis();
-    if ((unsigned long)(currentMillis - _lastPressMillis) <= MULTI_PRESS_TERM) {
+    // 処理した時間ではなくスイッチが押された時刻で判定する
+    if ((uint32_t)(_eventTime - _lastPressTime) <= msToTimestamp(MULTI_PRESS_TERM)) {
         _state++;
     } else {
         _state = 0;
     }
-    _lastPressMillis = currentMillis;
+    _lastPressTime = _eventTime;
 
     if (_state == _len) {
         _state = 0;
@@ -310,16 +323,25 @@ TapOrPress::TapOrPress(uint ms, Command *tapCommand, Command *pressCommand)
 // _state = 1 ms待ち
 // _state = 2 tap確定
 // _state = 3 press確定
+// tapかpressかはスイッチを押した時刻と離した時刻の差で判定する
 void TapOrPress::onPress() {
     if (_state == 0) {
         _state = 1;
-        changePeriod(_ms);
-        startTimer();
+        _pressTime = _eventTime;
+        // 押された時刻からmsで発火するようにする、処理が遅れて過ぎていてもloopがすぐ発火させる
+        startTimerAt(_pressTime + msToTimestamp(_ms));
     }
 }
 
 void TapOrPress::onRelease() {
-    if (_state == 1) {
+    if (_state == 1 && (uint32_t)(_eventTime - _pressTime) >= msToTimestamp(_ms)) {
+        // ms以上押されていたがタイマーの処理より先にリリースが処理された
+        stopTimer();
+        _lastPressedCommand = _pressCommand;
+        _pressCommand->onPress();
+        _pressCommand->onRelease();
+        _state = 0;
+    } else if (_state == 1) {
         _state = 2;
         _lastPressedCommand = _tapCommand;
         _tapCommand->onPress();
@@ -28,6 +28,7 @@
 #include "LayerController.h"
 #include "SpeedController.h"
 #include "Timer.h"
+#include "Timestamp.h"
 #include "config.h"
 #include "keycode.h"
 
@@ -36,12 +37,20 @@ class Command {
   public:
     static void init(BLEHidAdafruit &blehid);
 
+    // これから処理するキー入力やタイマーのイベントが発生した時刻を設定する
+    static void setEventTime(Timestamp time);
+
+    // beginReportBatchからendReportBatchまでの間に変化したキーボードのレポートをまとめて送る
+    static void beginReportBatch();
+    static void endReportBatch();
+
     void apply(bool pressed);
     virtual void onPress() {}
     virtual void onRelease() {}
 
   protected:
     static Command *_lastPressedCommand;
+    static Timestamp _eventTime;
     static HidWrapper _hid;
     static LayerController _layerController;
     static SpeedController _speedController;
@@ -166,7 +175,7 @@ class DetectMultiPress : public Command {
     Command *_executingCommand;
     const uint _len;
     uint _state = 0;
-    unsigned long _lastPressMillis = 0;
+    Timestamp _lastPressTime = 0;
 };
 /*------------------------------------------------------------------*/
 class TapOrPress : public Command, public Timer {
@@ -179,6 +188,7 @@ class TapOrPress : public Command, public Timer {
   private:
     const uint _ms;
     uint8_t _state = 0;
+    Timestamp _pressTime = 0;
     Command *_tapCommand;
     Command *_pressCommand;
 };
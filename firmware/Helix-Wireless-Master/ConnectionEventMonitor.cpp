@@ -0,0 +1,150 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "ConnectionEventMonitor.h"
+
+// 通知の時刻の揺れの許容範囲 (us)、割り込みの遅れとペリフェラル側の受信窓の広がりの分
+const static int32_t TOLERANCE_US = 150;
+// 1つの接続イベントに割り当てる時間 (us)、setupでconfigPrphBandwidth/configCentralBandwidthに設定する物と同じ
+const static int32_t EVENT_LENGTH_US = 2500;
+// 通知がこの数だけ続けて来なければ、間隔が変わったか接続が止まったとして格子を探し直す
+const static uint32_t LOCK_LOST_EVENTS = 8;
+
+static int64_t timestampToUs(int32_t ticks) {
+    return (int64_t)ticks * 1000000 / TIMESTAMP_FREQUENCY;
+}
+
+static Timestamp usToTimestamp(uint64_t us) {
+    return (Timestamp)((us * TIMESTAMP_FREQUENCY + 500000) / 1000000);
+}
+
+void ConnectionEventMonitor::setInterval(int link, uint16_t interval) {
+    Track &track = _tracks[link];
+    uint32_t intervalUs = (uint32_t)interval * 1250;
+    if (track.intervalUs != intervalUs) {
+        track.intervalUs = intervalUs;
+        track.isLocked = false;
+    }
+}
+
+void ConnectionEventMonitor::notified(Timestamp time) {
+    bool isMatched = false;
+    for (Track &track : _tracks) {
+        if (track.intervalUs != 0 && track.isLocked && advance(track, time)) {
+            // 両方の格子に乗る時は重なっていてどちらの物か分からないが、両方とも行われたことにする
+            isMatched = true;
+        }
+    }
+    if (isMatched == false && acquire(time) == false) {
+        _candidates[_candidateIndex] = time;
+        _candidateIndex = (_candidateIndex + 1) % CANDIDATE_COUNT;
+        if (_candidateCount < CANDIDATE_COUNT) {
+            _candidateCount++;
+        }
+    }
+}
+
+bool ConnectionEventMonitor::advance(Track &track, Timestamp time) {
+    uint32_t skipped = 0;
+    uint32_t collisions = 0;
+    while (true) {
+        Timestamp expected = track.anchor + usToTimestamp((uint64_t)track.next * track.intervalUs);
+        int64_t diff = timestampToUs((int32_t)(time - expected));
+        if (diff < -TOLERANCE_US) {
+            // まだ次の点の前、もう一方の接続の通知
+            track.stats.skipped += skipped;
+            track.stats.collisions += collisions;
+            return false;
+        }
+        if (collides(track, expected)) {
+            collisions++;
+        }
+        if (diff <= TOLERANCE_US) {
+            track.stats.events++;
+            track.stats.skipped += skipped;
+            track.stats.collisions += collisions;
+            // 揺れが溜まらないように通知が来た時刻から数え直す
+            track.anchor = time;
+            track.next = 1;
+            return true;
+        }
+        // 予定の時刻を過ぎても通知が来なかった
+        skipped++;
+        track.next++;
+        // 格子がずれた時は通知ごとに1つずつ飛ばされるので、前の通知の時の分も合わせて続けて来なかった数で判断する
+        if (track.next > LOCK_LOST_EVENTS) {
+            // 飛ばされたのではなく間隔が変わったか止まったので数えない
+            track.isLocked = false;
+            track.stats.lockLosses++;
+            return false;
+        }
+    }
+}
+
+bool ConnectionEventMonitor::collides(const Track &track, Timestamp time) const {
+    for (const Track &other : _tracks) {
+        if (&other == &track || other.intervalUs == 0 || other.isLocked == false) {
+            continue;
+        }
+        int64_t phase = timestampToUs((int32_t)(time - other.anchor)) % (int64_t)other.intervalUs;
+        if (phase < 0) {
+            phase += other.intervalUs;
+        }
+        if (phase < EVENT_LENGTH_US || (int64_t)other.intervalUs - phase < EVENT_LENGTH_US) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ConnectionEventMonitor::acquire(Timestamp time) {
+    // 間隔の短い方から探す、長い方の間隔が短い方の倍数だと短い方の通知2回を長い方と間違えるので
+    Track *order[LINK_COUNT];
+    for (int i = 0; i < LINK_COUNT; i++) {
+        order[i] = &_tracks[i];
+    }
+    for (int i = 1; i < LINK_COUNT; i++) {
+        for (int j = i; j > 0 && order[j]->intervalUs < order[j - 1]->intervalUs; j--) {
+            Track *tmp = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = tmp;
+        }
+    }
+    for (Track *track : order) {
+        if (track->intervalUs == 0 || track->isLocked) {
+            continue;
+        }
+        for (int i = 0; i < _candidateCount; i++) {
+            int64_t diff = timestampToUs((int32_t)(time - _candidates[i])) - track->intervalUs;
+            if (diff >= -TOLERANCE_US && diff <= TOLERANCE_US) {
+                track->isLocked = true;
+                track->anchor = time;
+                track->next = 1;
+                track->stats.events++;
+                return true;
+            }
+        }
+    }
+    return false;
+}
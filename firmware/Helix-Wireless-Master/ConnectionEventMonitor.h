@@ -0,0 +1,80 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "Timestamp.h"
+#include <Arduino.h>
+
+// 1つの接続の接続イベントの統計
+struct ConnectionEventStats {
+    uint32_t events;     // 予定の時刻に無線の動作の通知が来た接続イベント
+    uint32_t skipped;    // 予定の時刻に通知が来なかった(SoftDeviceが飛ばした)接続イベント
+    uint32_t collisions; // もう一方の接続の接続イベントと重なる予定だった接続イベント
+    uint32_t lockLosses; // 通知が続けて来なくなって予定を立て直した回数
+};
+
+// 無線の動作の通知(RadioNotification)の時刻から、PCとスレーブ側の2つの接続の接続イベントが予定通りに行われたかを数える
+// 通知はどちらの接続の物か分からないので、それぞれの接続間隔の格子に乗る物をその接続の物とする
+// どちらの格子にも乗らない通知が間隔1つ分離れて2回来たら、その接続の格子の始まりとする
+// 通知が来なかった格子の点は飛ばされた接続イベント、もう一方の格子の点とイベントの長さより近い点は重なる予定だった接続イベント
+class ConnectionEventMonitor {
+  public:
+    const static int LINK_COUNT = 2;
+
+    // 接続の間隔(1.25ms単位)が決まった時に呼ぶ、0なら数えない
+    // 切断中や、スレーブレイテンシで自分から接続イベントを飛ばす間は0にする
+    void setInterval(int link, uint16_t interval);
+
+    // 通知の割り込みから呼ぶ
+    void notified(Timestamp time);
+
+    const ConnectionEventStats &stats(int link) const {
+        return _tracks[link].stats;
+    }
+
+  private:
+    struct Track {
+        uint32_t intervalUs; // 0なら数えない
+        bool isLocked;       // 格子の始まりが分かっているか
+        Timestamp anchor;    // 最後に通知が来た格子の点
+        uint32_t next;       // 次に通知が来るはずの点がanchorからいくつ先か
+        ConnectionEventStats stats;
+    };
+
+    // trackの格子の点を通知の時刻まで進める、通知が格子に乗っていればtrue
+    bool advance(Track &track, Timestamp time);
+    // trackの接続イベントtimeがもう一方の接続の接続イベントと重なるか
+    bool collides(const Track &track, Timestamp time) const;
+    // どちらの格子にも乗らなかった通知から格子の始まりを探す
+    bool acquire(Timestamp time);
+
+    const static int CANDIDATE_COUNT = 4;
+
+    Track _tracks[LINK_COUNT] = {};
+    // どちらの格子にも乗らなかった最近の通知
+    Timestamp _candidates[CANDIDATE_COUNT] = {};
+    int _candidateCount = 0;
+    int _candidateIndex = 0;
+};
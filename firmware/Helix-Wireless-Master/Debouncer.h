@@ -0,0 +1,86 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+// スイッチ1個分のチャタリング除去の方式、時間は全てms
+//   pressDelay   : 押した時、入力がこの時間変化しなかったら確定する (0なら最初の変化ですぐ確定)
+//   releaseDelay : 離した時、入力がこの時間変化しなかったら確定する (0なら最初の変化ですぐ確定)
+//   lockout      : 状態が確定してからこの時間は入力を無視する
+struct DebouncePolicy {
+    uint8_t pressDelay;
+    uint8_t releaseDelay;
+    uint8_t lockout;
+};
+
+// 入力がdelayの間変化しなかったら確定する (今までと同じ方式)
+constexpr DebouncePolicy DEFER(uint8_t delay) {
+    return DebouncePolicy{delay, delay, 0};
+}
+
+// 最初の変化ですぐ確定して、その後lockoutの間は入力を無視する
+constexpr DebouncePolicy EAGER(uint8_t lockout) {
+    return DebouncePolicy{0, 0, lockout};
+}
+
+// 押した時と離した時で確定までの時間を変える
+constexpr DebouncePolicy ASYM(uint8_t pressDelay, uint8_t releaseDelay) {
+    return DebouncePolicy{pressDelay, releaseDelay, 0};
+}
+
+// マトリックス全体のチャタリングをまとめて取り除くクラス
+// スイッチ1個を1ビットに割り当てて、スイッチごとの連続変化回数と入力を無視する残り回数を
+// ビットプレーンのカウンター(vertical counter)で持つ
+// 1回の更新はスイッチの数に関係なく数回のワード演算で終わる
+class Debouncer {
+  public:
+    // カウンターのビット数、確定までの回数と入力を無視する回数は最大で(2^COUNTER_BITS - 1)回
+    static const uint8_t COUNTER_BITS = 4;
+    static const uint8_t MAX_SAMPLES = (1 << COUNTER_BITS) - 1;
+
+    // n番目のビットのスイッチの方式を設定する、scanPeriodはスキャン周期(us)で時間を回数に変換するのに使う
+    // スキャン周期を変えた時は設定し直す
+    void setPolicy(uint8_t n, const DebouncePolicy &policy, uint32_t scanPeriod);
+
+    // 今回のスキャン結果(押されているスイッチのビットが1)を渡して状態を更新する
+    // 戻り値は確定した状態が変化したビット
+    uint64_t update(uint64_t raw);
+
+    // 確定している状態
+    uint64_t state() const;
+
+    // チャタリング除去中(カウント中か入力を無視している最中)のスイッチが無ければtrue
+    bool isSettled() const;
+
+  private:
+    uint64_t _state = 0;
+    uint64_t _count[COUNTER_BITS] = {};
+    uint64_t _lock[COUNTER_BITS] = {};
+    // スイッチごとのしきい値、ビットプレーンに展開して持つ
+    uint64_t _pressSamples[COUNTER_BITS] = {};
+    uint64_t _releaseSamples[COUNTER_BITS] = {};
+    uint64_t _lockoutSamples[COUNTER_BITS] = {};
+};
@@ -12,18 +12,50 @@
  any redistribution
 *********************************************************************/
 
+#include "Command.h"
+#include "ConnectionEventMonitor.h"
+#include "LinkManager.h"
+#include "RadioNotification.h"
 #include "batteryService.h"
 #include "blinkLED.h"
 #include "config.h"
 #include "keyScan.h"
 #include "keymap.h"
+#include "Timer.h"
+#include "SplitClientService.h"
+#include "splitReceiver.h"
 #include "queues.h"
 #include <bluefruit.h>
 
 static BLEDis bledis;
 static BLEBas blebas;
 static BLEHidAdafruit blehid;
-static BLEClientUart clientUart;
+static SplitClientService splitClient;
+
+// PCとスレーブ側それぞれの接続のコネクションパラメーターをキー入力に合わせて切り替える
+const static LinkPolicy hostLinkPolicy = {
+    HOST_LINK_ACTIVE_INTERVAL_MIN,
+    HOST_LINK_ACTIVE_INTERVAL_MAX,
+    HOST_LINK_IDLE_INTERVAL_MIN,
+    HOST_LINK_IDLE_INTERVAL_MAX,
+    HOST_LINK_IDLE_SLAVE_LATENCY,
+    LINK_IDLE_TIMEOUT,
+};
+const static LinkPolicy splitLinkPolicy = {
+    SPLIT_LINK_ACTIVE_INTERVAL_MIN,
+    SPLIT_LINK_ACTIVE_INTERVAL_MAX,
+    SPLIT_LINK_IDLE_INTERVAL_MIN,
+    SPLIT_LINK_IDLE_INTERVAL_MAX,
+    SPLIT_LINK_IDLE_SLAVE_LATENCY,
+    LINK_IDLE_TIMEOUT,
+};
+static LinkManager hostConnection(hostLinkPolicy);
+static LinkManager splitConnection(splitLinkPolicy);
+
+// 2つの接続の接続イベントが予定通りに行われたか、無線の動作の通知から数える
+const static int HOST_LINK = 0;
+const static int SPLIT_LINK = 1;
+static ConnectionEventMonitor connectionEvents;
 
 static inline void blinkScanLED() { blinkLED1(); }
 static inline void blinkAdvLED() { blinkLED2(); }
@@ -35,6 +67,10 @@ void setup() {
     // シリアルをオンにすると消費電流が増えるのでデバッグ時以外はオフにする
     //Serial.begin(115200);
 
+    // 1つの接続イベントに割り当てる時間を最小(2.5ms)にして、2つの接続の接続イベントが1つの間隔に並んで収まるようにする
+    // フレームもHIDのレポートも1回の通知に収まるので、MTUもデフォルトのままでいい
+    Bluefruit.configPrphBandwidth(BANDWIDTH_LOW);
+    Bluefruit.configCentralBandwidth(BANDWIDTH_LOW);
     Bluefruit.begin(1, 1);
     sd_power_dcdc_mode_set(NRF_POWER_DCDC_ENABLE);
     Bluefruit.setTxPower(TX_POWER);
@@ -42,6 +78,7 @@ void setup() {
     Bluefruit.autoConnLed(false);
     Bluefruit.setConnectCallback(prph_connect_callback);
     Bluefruit.setDisconnectCallback(prph_disconnect_callback);
+    Bluefruit.setEventCallback(ble_event_callback);
 
     // Configure and Start Device Information Service
     bledis.setManufacturer(MANUFACTURER_NAME);
@@ -62,8 +99,7 @@ void setup() {
    */
     blehid.begin();
 
-    clientUart.begin();
-    clientUart.setRxCallback(bleuart_rx_callback);
+    splitClient.begin();
 
     // Initialize Keyboard Resource
     initQueues();
@@ -73,23 +109,29 @@ void setup() {
     initLED(priority);
     initKeymap(blehid);
     startKeyScan(priority);
+    startSplitReceiver(splitClient);
+    hostConnection.start();
+    splitConnection.start();
+    // スレーブ側との接続の間隔はPCとの接続の間隔の整数倍か整数分の1にする
+    splitConnection.alignTo(hostConnection);
+    radioNotification.init(radio_notification_callback);
 
     // Callbacks for Central
     Bluefruit.Central.setConnectCallback(cent_connect_callback);
     Bluefruit.Central.setDisconnectCallback(cent_disconnect_callback);
-    Bluefruit.Central.setConnIntervalMS(10, 20);
+    Bluefruit.Central.setConnInterval(SPLIT_LINK_ACTIVE_INTERVAL_MIN, SPLIT_LINK_ACTIVE_INTERVAL_MAX);
 
     /* Start Central Scanning
    * - Enable auto scan if disconnected
    * - Interval = 100 ms, window = 80 ms
-   * - Filter only accept bleuart service
+   * - Filter only accept split service
    * - Don't use active scan
    * - Start(timeout) with timeout = 0 will scan forever (until connected)
    */
     Bluefruit.Scanner.setRxCallback(scan_callback);
     Bluefruit.Scanner.restartOnDisconnect(true);
     Bluefruit.Scanner.setInterval(160, 80); // in unit of 0.625 ms
-    Bluefruit.Scanner.filterUuid(clientUart.uuid);
+    Bluefruit.Scanner.filterUuid(splitClient.uuid);
     Bluefruit.Scanner.useActiveScan(false);
     Bluefruit.Scanner.start(0); // 0 = Don't stop scanning after n seconds
     blinkScanLED();             //scan status led*/
@@ -98,7 +140,7 @@ void setup() {
    * Note: It is already set by BLEHidAdafruit::begin() to 11.25ms - 15ms
    * min = 9*1.25=11.25 ms, max = 12*1.25= 15 ms
    */
-    /* Bluefruit.setConnInterval(9, 12); */
+    Bluefruit.setConnInterval(HOST_LINK_ACTIVE_INTERVAL_MIN, HOST_LINK_ACTIVE_INTERVAL_MAX);
 
     // Set up and start advertising
     startAdv();
@@ -132,25 +174,109 @@ static void startAdv(void) {
     blinkAdvLED();                              // advertising status led
 }
 
+// timeまでに期限が来たタイマーを期限順に発火させる
+static void fireTimers(Timestamp time) {
+    Timer *timer;
+    while ((timer = Timer::nextExpired(time)) != nullptr) {
+        Command::setEventTime(timer->deadline());
+        timer->fire();
+    }
+}
+
 void loop() {
-    static UInt8Set scanIDs, bleIDs;
+    KeyState state;
+    // 次のタイマーの期限までキーの状態の変化を待つ
+    if (receiveKeyState(state, ticksUntilNextTimer())) {
+        // どちら側のキーでも両方の接続をACTIVEにする、スレーブ側のキーの後は大抵PCへのレポートが続く
+        hostConnection.keyActivity();
+        splitConnection.keyActivity();
+        // 1回起きたら更新されている物とCOALESCING_WINDOWの間に更新された物を全部処理して、レポートは最後にまとめて送る
+        Timestamp windowEnd = state.firstChangeTime + msToTimestamp(COALESCING_WINDOW);
+        Command::beginReportBatch();
+        do {
+            // 変化より前に期限が来ていたタイマーを先に発火させて、順番を変化の時刻通りにする
+            fireTimers(state.firstChangeTime);
+            applyKeyState(state);
+        } while (receiveKeyState(state, Timer::ticksUntil(windowEnd)));
+        Command::endReportBatch();
+    }
+    // SPLIT_REORDER_WINDOWで待たせている変化より後が期限のタイマーは、その変化を処理するまで発火させない
+    fireTimers(timerFiringLimit(currentTimestamp()));
+
+    //dbgMemInfo();
+    //dbgStats();
+}
+
+/*------------------------------------------------------------------*/
+/* Connection parameters
+ *------------------------------------------------------------------*/
 
-    EventData data = {};
-    xQueueReceive(eventQueue, &data, portMAX_DELAY);
+// 接続の実際のパラメーターを知らせる
+static void updateLink(LinkManager &link, int index, const ble_gap_conn_params_t &params) {
+    link.updated(params);
+    // PCとの接続でスレーブレイテンシがある間はこちらから接続イベントを飛ばすので数えない
+    uint16_t interval = (index == HOST_LINK && params.slave_latency != 0) ? 0 : params.max_conn_interval;
+    taskENTER_CRITICAL();
+    connectionEvents.setInterval(index, interval);
+    taskEXIT_CRITICAL();
+}
 
-    if (data.eventType == SCAN_KEY_EVENT || data.eventType == BLE_KEY_EVENT) {
-        if (data.eventType == SCAN_KEY_EVENT) {
-            scanIDs = data.ids;
-        } else if (data.eventType == BLE_KEY_EVENT) {
-            bleIDs = data.ids;
+static void ble_event_callback(ble_evt_t *event) {
+    const ble_gap_evt_t &gap = event->evt.gap_evt;
+    if (event->header.evt_id == BLE_GAP_EVT_CONNECTED) {
+        // 接続のコールバックより先に呼ばれることがあるので、どちらの接続かは役割で分ける
+        if (gap.params.connected.role == BLE_GAP_ROLE_PERIPH) {
+            updateLink(hostConnection, HOST_LINK, gap.params.connected.conn_params);
+        } else {
+            updateLink(splitConnection, SPLIT_LINK, gap.params.connected.conn_params);
+        }
+    } else if (event->header.evt_id == BLE_GAP_EVT_CONN_PARAM_UPDATE) {
+        if (gap.conn_handle == hostConnection.connHandle()) {
+            updateLink(hostConnection, HOST_LINK, gap.params.conn_param_update.conn_params);
+        } else if (gap.conn_handle == splitConnection.connHandle()) {
+            updateLink(splitConnection, SPLIT_LINK, gap.params.conn_param_update.conn_params);
         }
-        applyToKeymap(scanIDs | bleIDs);
+    }
+}
 
-    } else if (data.eventType == TIMER_EVENT) {
-        data.timer->onTimer();
+// 無線が動き出す前の割り込み
+static void radio_notification_callback(BaseType_t *woken) {
+    Timestamp time;
+    if (radioNotification.lastNotification(time)) {
+        connectionEvents.notified(time);
     }
+}
 
-    //dbgMemInfo();
+// 接続ごとの統計、割り込みやBLEのタスクからも書き換えられるので止めてコピーする
+ConnectionEventStats connectionEventStats(int link) {
+    taskENTER_CRITICAL();
+    ConnectionEventStats stats = connectionEvents.stats(link);
+    taskEXIT_CRITICAL();
+    return stats;
+}
+
+LinkStats linkStats(int link) {
+    taskENTER_CRITICAL();
+    LinkStats stats = (link == HOST_LINK) ? hostConnection.stats() : splitConnection.stats();
+    taskEXIT_CRITICAL();
+    return stats;
+}
+
+// デバッグ用、接続ごとの統計とメールボックスの統計をシリアルに書き出す
+void dbgStats() {
+    for (int link = HOST_LINK; link <= SPLIT_LINK; link++) {
+        ConnectionEventStats events = connectionEventStats(link);
+        LinkStats requests = linkStats(link);
+        Serial.printf("link %d: events=%lu skipped=%lu collisions=%lu lockLosses=%lu\n", link,
+                      (unsigned long)events.events, (unsigned long)events.skipped,
+                      (unsigned long)events.collisions, (unsigned long)events.lockLosses);
+        Serial.printf("link %d: active=%lu idle=%lu aligned=%lu failures=%lu\n", link,
+                      (unsigned long)requests.activeRequests, (unsigned long)requests.idleRequests,
+                      (unsigned long)requests.alignedRequests, (unsigned long)requests.failures);
+    }
+    MailboxStats mailbox = mailboxStats();
+    Serial.printf("mailbox: scanMerges=%lu bleMerges=%lu\n",
+                  (unsigned long)mailbox.scanMerges, (unsigned long)mailbox.bleMerges);
 }
 
 /*------------------------------------------------------------------*/
@@ -159,10 +285,15 @@ void loop() {
 
 static void prph_connect_callback(uint16_t conn_handle) {
     turnOffAdvLED();
+    hostConnection.connected(conn_handle);
 }
 
 static void prph_disconnect_callback(uint16_t conn_handle, uint8_t reason) {
     blinkAdvLED();
+    hostConnection.disconnected();
+    taskENTER_CRITICAL();
+    connectionEvents.setInterval(HOST_LINK, 0);
+    taskEXIT_CRITICAL();
 }
 
 /*------------------------------------------------------------------*/
@@ -170,42 +301,30 @@ static void prph_disconnect_callback(uint16_t conn_handle, uint8_t reason) {
  *------------------------------------------------------------------*/
 
 static void scan_callback(ble_gap_evt_adv_report_t *report) {
-    // Check if advertising contain BleUart service
-    if (Bluefruit.Scanner.checkReportForService(report, clientUart)) {
-        // Connect to device with bleuart service in advertising
+    // Check if advertising contain split service
+    if (Bluefruit.Scanner.checkReportForService(report, splitClient)) {
+        // Connect to device with split service in advertising
         Bluefruit.Central.connect(report);
     }
 }
 
 static void cent_connect_callback(uint16_t conn_handle) {
-    if (clientUart.discover(conn_handle)) {
-        // Enable TXD's notify
-        clientUart.enableTXD();
+    if (splitClient.discover(conn_handle)) {
+        splitClient.enableNotify();
         turnOffScanLED();
+        splitClient.setConnected(true);
+        splitConnection.connected(conn_handle);
     } else {
-        // disconect since we couldn't find bleuart service
+        // disconect since we couldn't find split service
         Bluefruit.Central.disconnect(conn_handle);
     }
 }
 
 static void cent_disconnect_callback(uint16_t conn_handle, uint8_t reason) {
     blinkScanLED();
-    // 切断されたらキーが押しっぱなしにならないように空のデータを送る
-    EventData data = {
-        .eventType = BLE_KEY_EVENT,
-    };
-    xQueueSend(eventQueue, &data, portMAX_DELAY);
-}
-
-static void bleuart_rx_callback(BLEClientUart &uart_svc) {
-    EventData data = {
-        .eventType = BLE_KEY_EVENT,
-    };
-    while (uart_svc.available()) {
-        data.ids.add(uart_svc.read());
-    }
-    // 終端0を取る
-    data.ids.remove(0);
-    // loopに送る
-    xQueueSend(eventQueue, &data, portMAX_DELAY);
+    splitConnection.disconnected();
+    splitClient.setConnected(false);
+    taskENTER_CRITICAL();
+    connectionEvents.setInterval(SPLIT_LINK, 0);
+    taskEXIT_CRITICAL();
 }
@@ -63,55 +63,56 @@ void HidWrapper::oneShotModifier(Modifier modifier) {
 }
 
 void HidWrapper::sendKeyReportIfChanged() {
-    bool isChanged = false;
-
-    // normal key check
-    if (memcmp(_prevSentKeys, _pressedKeys, sizeof(_prevSentKeys)) != 0) {
-        memcpy(_prevSentKeys, _pressedKeys, sizeof(_prevSentKeys));
-        isChanged = true;
-    }
+    Modifier modifier = currentModifier();
 
-    // modifier Key check
-    Modifier modifier = _oneShotModifier;
-    _oneShotModifier = static_cast<Modifier>(0);
-
-    for (int i = 0; i < 8; i++) {
-        if (_modifierCount[i] != 0) {
-            modifier = static_cast<Modifier>(static_cast<uint8_t>(modifier) | bit(i));
+    if (_isBatching) {
+        if (_hasPendingReport && isRevertedBeforeSent(modifier)) {
+            flushKeyReport();
         }
+        memcpy(_pendingKeys, _pressedKeys, sizeof(_pendingKeys));
+        _pendingModifier = modifier;
+        _hasPendingReport = true;
+        return;
     }
-    if (modifier != _prevSentModifier) {
-        _prevSentModifier = modifier;
-        isChanged = true;
-    }
+    sendKeyReport(_pressedKeys, modifier);
+}
 
-    // send KeyboardReport
-    if (isChanged) {
-        _blehid->keyboardReport(static_cast<uint8_t>(modifier), _pressedKeys);
-    }
+void HidWrapper::beginBatch() {
+    _isBatching = true;
+}
+
+void HidWrapper::endBatch() {
+    _isBatching = false;
+    flushKeyReport();
 }
 
 void HidWrapper::consumerKeyPress(UsageCode usageCode) {
+    flushKeyReport();
     _blehid->consumerKeyPress(static_cast<uint16_t>(usageCode));
 }
 
 void HidWrapper::consumerKeyRelease() {
+    flushKeyReport();
     _blehid->consumerKeyRelease();
 }
 
 void HidWrapper::mouseMove(int8_t x, int8_t y) {
+    flushKeyReport();
     _blehid->mouseMove(x, y);
 }
 
 void HidWrapper::mouseScroll(int8_t scroll) {
+    flushKeyReport();
     _blehid->mouseScroll(scroll);
 }
 
 void HidWrapper::mousePan(int8_t pan) {
+    flushKeyReport();
     _blehid->mousePan(pan);
 }
 
 void HidWrapper::mouseButtonPress(MouseButton button) {
+    flushKeyReport();
     for (int i = 0; i < 5; i++) {
         if (bitRead(static_cast<uint8_t>(button), i)) {
             _buttonCount[i]++;
@@ -121,6 +122,7 @@ void HidWrapper::mouseButtonPress(MouseButton button) {
 }
 
 void HidWrapper::mouseButtonRelease(MouseButton button) {
+    flushKeyReport();
     for (int i = 0; i < 5; i++) {
         if (bitRead(static_cast<uint8_t>(button), i)) {
             _buttonCount[i]--;
@@ -163,6 +165,73 @@ void HidWrapper::removeKey(uint8_t keycode) {
     }
 }
 
+Modifier HidWrapper::currentModifier() {
+    Modifier modifier = _oneShotModifier;
+    _oneShotModifier = static_cast<Modifier>(0);
+
+    for (int i = 0; i < 8; i++) {
+        if (_modifierCount[i] != 0) {
+            modifier = static_cast<Modifier>(static_cast<uint8_t>(modifier) | bit(i));
+        }
+    }
+    return modifier;
+}
+
+// 溜めているレポートで変わったキーや修飾キーが、今の状態で送った時の状態に戻っているか
+// (送っていないまま押して離された、送ってあるのに離したまま送らずに押し直された)
+bool HidWrapper::isRevertedBeforeSent(Modifier modifier) {
+    uint8_t pending = static_cast<uint8_t>(_pendingModifier);
+    uint8_t changedModifier = pending ^ static_cast<uint8_t>(_prevSentModifier);
+    if ((changedModifier & (pending ^ static_cast<uint8_t>(modifier))) != 0) {
+        return true;
+    }
+    for (int i = 0; i < 6 && _pendingKeys[i] != 0; i++) {
+        uint8_t keycode = _pendingKeys[i];
+        if (memchr(_prevSentKeys, keycode, sizeof(_prevSentKeys)) == nullptr &&
+            memchr(_pressedKeys, keycode, 6) == nullptr) {
+            return true;
+        }
+    }
+    for (int i = 0; i < 6 && _prevSentKeys[i] != 0; i++) {
+        uint8_t keycode = _prevSentKeys[i];
+        if (memchr(_pendingKeys, keycode, sizeof(_pendingKeys)) == nullptr &&
+            memchr(_pressedKeys, keycode, 6) != nullptr) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void HidWrapper::sendKeyReport(const uint8_t *keys, Modifier modifier) {
+    bool isChanged = false;
+
+    // normal key check
+    if (memcmp(_prevSentKeys, keys, sizeof(_prevSentKeys)) != 0) {
+        memcpy(_prevSentKeys, keys, sizeof(_prevSentKeys));
+        isChanged = true;
+    }
+
+    // modifier Key check
+    if (modifier != _prevSentModifier) {
+        _prevSentModifier = modifier;
+        isChanged = true;
+    }
+
+    // send KeyboardReport
+    if (isChanged) {
+        uint8_t report[6];
+        memcpy(report, keys, sizeof(report));
+        _blehid->keyboardReport(static_cast<uint8_t>(modifier), report);
+    }
+}
+
+void HidWrapper::flushKeyReport() {
+    if (_hasPendingReport) {
+        _hasPendingReport = false;
+        sendKeyReport(_pendingKeys, _pendingModifier);
+    }
+}
+
 void HidWrapper::sendMouseButtonReportIfChanged() {
     MouseButton button = static_cast<MouseButton>(0);
 
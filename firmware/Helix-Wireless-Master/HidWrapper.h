@@ -50,6 +50,13 @@ class HidWrapper {
 
     void sendKeyReportIfChanged();
 
+    // beginBatchからendBatchまでの間はsendKeyReportIfChangedで送らずに溜めておき、endBatchでまとめて1回送る。
+    // 溜めている間に押されたキーが送られないまま離される時や、送ったキーが離された後で送られないまま押し直される時は、
+    // 溜めていた状態を先に送ってから溜め直す。同じキーの変化はまとめずに全部送る。
+    void beginBatch();
+
+    void endBatch();
+
     // Consumer API
     // BLEHidAdafruitクラスの同じ名前のメソッドを呼び出すだけ。
     // 同時押しは非対応
@@ -74,6 +81,11 @@ class HidWrapper {
     void addKey(uint8_t keycode);
     void removeKey(uint8_t keycode);
 
+    Modifier currentModifier();
+    bool isRevertedBeforeSent(Modifier modifier);
+    void sendKeyReport(const uint8_t *keys, Modifier modifier);
+    void flushKeyReport();
+
     void sendMouseButtonReportIfChanged();
 
     BLEHidAdafruit *_blehid;
@@ -86,6 +98,11 @@ class HidWrapper {
     Modifier _prevSentModifier = static_cast<Modifier>(0);
     Modifier _oneShotModifier = static_cast<Modifier>(0);
 
+    bool _isBatching = false;
+    bool _hasPendingReport = false;
+    uint8_t _pendingKeys[6] = {};
+    Modifier _pendingModifier = static_cast<Modifier>(0);
+
     MouseButton _prevSentButton = static_cast<MouseButton>(0);
     uint8_t _buttonCount[5] = {};
 };
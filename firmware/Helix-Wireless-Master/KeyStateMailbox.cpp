@@ -0,0 +1,98 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "KeyStateMailbox.h"
+
+void KeyStateMailbox::publish(uint64_t pressed, Timestamp time) {
+    uint32_t seq = _seq + 1;
+    if (_readSeq == _seq) {
+        // 前回の書き込みまで読まれているので変化を溜め直す
+        _changed = 0;
+        _baseSeq = _seq;
+        _firstChangeTime = time;
+    } else {
+        _mergeCount = _mergeCount + 1;
+    }
+    _changed |= _pressed ^ pressed;
+    _pressed = pressed;
+
+    // 読み出し側が読んでいるかもしれない_blocks[_seq & 1]ではない方に書く
+    Block &block = _blocks[seq & 1];
+    block.version = block.version + 1;
+    __sync_synchronize();
+    block.seq = seq;
+    block.baseSeq = _baseSeq;
+    block.pressed = pressed;
+    block.changed = _changed;
+    block.firstChangeTime = _firstChangeTime;
+    block.time = time;
+    __sync_synchronize();
+    block.version = block.version + 1;
+    __sync_synchronize();
+    _seq = seq;
+}
+
+bool KeyStateMailbox::read(KeyState &state) {
+    Block copy;
+    while (1) {
+        uint32_t seq = _seq;
+        if (seq == _readSeq) {
+            return false;
+        }
+        const Block &block = _blocks[seq & 1];
+        uint32_t version = block.version;
+        __sync_synchronize();
+        copy.seq = block.seq;
+        copy.baseSeq = block.baseSeq;
+        copy.pressed = block.pressed;
+        copy.changed = block.changed;
+        copy.firstChangeTime = block.firstChangeTime;
+        copy.time = block.time;
+        __sync_synchronize();
+        // 読んでいる間に2回書き込まれてこのバッファが書き換えられていたら読み直す
+        if ((version & 1) == 0 && version == block.version) {
+            break;
+        }
+    }
+
+    state.pressed = copy.pressed;
+    if (copy.baseSeq == _readSeq) {
+        // 前回読んだ後からの変化が全部分かる
+        state.changed = copy.changed;
+    } else {
+        // 前回読んだのと同時に書き込まれた分も混ざっているので、状態の差だけを使う
+        state.changed = _lastPressed ^ copy.pressed;
+    }
+    state.bounced = state.changed & ~(_lastPressed ^ copy.pressed);
+    state.firstChangeTime = copy.firstChangeTime;
+    state.time = copy.time;
+
+    _lastPressed = copy.pressed;
+    _readSeq = copy.seq;
+    return true;
+}
+
+bool KeyStateMailbox::hasUpdate() const {
+    return _seq != _readSeq;
+}
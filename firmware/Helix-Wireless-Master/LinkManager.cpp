@@ -0,0 +1,169 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "LinkManager.h"
+
+// 接続が切れたと判断するまでの時間 (10ms単位)、IDLEでも(1 + スレーブレイテンシ) * 間隔 * 2より十分長くする
+const static uint16_t SUPERVISION_TIMEOUT = 400;
+
+LinkManager::LinkManager(const LinkPolicy &policy)
+    : Timer(policy.idleTimeout, true), _policy(policy), _connHandle(BLE_CONN_HANDLE_INVALID), _isIdle(false), _lastActivity(0), _stats() {
+}
+
+void LinkManager::alignTo(LinkManager &reference) {
+    _reference = &reference;
+    reference._follower = this;
+}
+
+uint16_t LinkManager::alignedInterval(uint16_t reference, uint16_t min, uint16_t max, bool preferShort) {
+    uint16_t best = 0;
+    auto consider = [&](uint32_t interval) {
+        // 範囲を外れた間隔にすると遅延や消費電流の前提が崩れるので、範囲に入る物だけにする
+        if (interval < min || interval > max ||
+            interval < BLE_GAP_CP_MIN_CONN_INTVL_MIN || interval > BLE_GAP_CP_MAX_CONN_INTVL_MAX) {
+            return;
+        }
+        if (best == 0 || (preferShort ? interval < best : interval > best)) {
+            best = interval;
+        }
+    };
+    if (reference == 0) {
+        return 0;
+    }
+    // 整数分の1
+    for (uint16_t k = 1; reference / k >= BLE_GAP_CP_MIN_CONN_INTVL_MIN; k++) {
+        if (reference % k == 0) {
+            consider(reference / k);
+        }
+    }
+    // 整数倍
+    for (uint32_t interval = reference; interval <= max; interval += reference) {
+        consider(interval);
+    }
+    return best;
+}
+
+void LinkManager::start() {
+    _lastActivity = currentTimestamp();
+    startTimer();
+}
+
+void LinkManager::connected(uint16_t connHandle) {
+    _connHandle = connHandle;
+    _isReconnected = true;
+}
+
+void LinkManager::disconnected() {
+    _connHandle = BLE_CONN_HANDLE_INVALID;
+    _interval = 0;
+}
+
+void LinkManager::updated(const ble_gap_conn_params_t &params) {
+    uint16_t interval = params.max_conn_interval;
+    if (interval == _interval) {
+        return;
+    }
+    _interval = interval;
+    // PCが間隔を変えたらスレーブ側の接続も合わせ直す
+    if (_follower != nullptr) {
+        _follower->_needsRealign = true;
+    }
+    _needsRealign = true;
+}
+
+void LinkManager::applyUpdates() {
+    if (_isReconnected) {
+        _isReconnected = false;
+        _isIdle = false;
+        // 実際のパラメーターの方が先に届いていても、ここで合わせる
+        _needsRealign = true;
+    }
+    if (_needsRealign) {
+        _needsRealign = false;
+        realign();
+    }
+}
+
+void LinkManager::realign() {
+    if (_reference == nullptr || _interval == 0) {
+        return;
+    }
+    // 接続した時はまだ合わせていない間隔なので合わせる、合わせた後は同じ間隔なので要求しない
+    uint16_t aligned = _isIdle ? alignedInterval(_reference->_interval, _policy.idleMinInterval, _policy.idleMaxInterval, false)
+                               : alignedInterval(_reference->_interval, _policy.activeMinInterval, _policy.activeMaxInterval, true);
+    if (aligned != 0 && aligned != _interval) {
+        request(_isIdle);
+    }
+}
+
+void LinkManager::keyActivity() {
+    _lastActivity = currentTimestamp();
+    applyUpdates();
+    if (_isIdle) {
+        request(false);
+    }
+}
+
+void LinkManager::onTimer() {
+    applyUpdates();
+    if (_isIdle == false && currentTimestamp() - _lastActivity >= msToTimestamp(_policy.idleTimeout)) {
+        request(true);
+    }
+}
+
+void LinkManager::request(bool isIdle) {
+    uint16_t connHandle = _connHandle;
+    if (connHandle == BLE_CONN_HANDLE_INVALID) {
+        return;
+    }
+    ble_gap_conn_params_t params;
+    if (isIdle) {
+        params.min_conn_interval = _policy.idleMinInterval;
+        params.max_conn_interval = _policy.idleMaxInterval;
+        params.slave_latency = _policy.idleSlaveLatency;
+        _stats.idleRequests++;
+    } else {
+        params.min_conn_interval = _policy.activeMinInterval;
+        params.max_conn_interval = _policy.activeMaxInterval;
+        params.slave_latency = 0;
+        _stats.activeRequests++;
+    }
+    // ACTIVEは遅延の小さい短い方、IDLEは消費電流の小さい長い方に合わせる
+    uint16_t aligned = (_reference != nullptr)
+                           ? alignedInterval(_reference->interval(), params.min_conn_interval, params.max_conn_interval, isIdle == false)
+                           : 0;
+    if (aligned != 0) {
+        params.min_conn_interval = aligned;
+        params.max_conn_interval = aligned;
+        _stats.alignedRequests++;
+    }
+    params.conn_sup_timeout = SUPERVISION_TIMEOUT;
+    // セントラル側なら直ぐに変更され、ペリフェラル側ならセントラル側に要求が送られる
+    if (sd_ble_gap_conn_param_update(connHandle, &params) != NRF_SUCCESS) {
+        // 接続処理中などで断られたら次のキー入力か確認のタイマーでもう一度試す
+        _stats.failures++;
+        return;
+    }
+    _isIdle = isIdle;
+}
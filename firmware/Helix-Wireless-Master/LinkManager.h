@@ -0,0 +1,112 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "Timer.h"
+#include <bluefruit.h>
+
+// 1つの接続のコネクションパラメーターの方針、間隔は1.25ms単位
+struct LinkPolicy {
+    uint16_t activeMinInterval;
+    uint16_t activeMaxInterval;
+    uint16_t idleMinInterval;
+    uint16_t idleMaxInterval;
+    uint16_t idleSlaveLatency;
+    uint32_t idleTimeout; // キー入力が無くなってからIDLEにするまでの時間 (ms)
+};
+
+struct LinkStats {
+    uint32_t activeRequests;  // ACTIVEのパラメーターを要求した回数
+    uint32_t idleRequests;    // IDLEのパラメーターを要求した回数
+    uint32_t alignedRequests; // その内、alignToした接続の間隔に合わせた間隔を要求した回数
+    uint32_t failures;        // SoftDeviceに断られた回数
+};
+
+// 1つの接続のコネクションパラメーターをキー入力に合わせて切り替える
+// キー入力がある間は短い間隔で遅延を小さく、入力が無くなったら長い間隔とスレーブレイテンシで消費電流を小さくする
+// idleTimeoutごとに確認するので、IDLEになるのはキー入力が無くなってからidleTimeoutから2倍の間
+class LinkManager : public Timer {
+  public:
+    LinkManager(const LinkPolicy &policy);
+
+    // referenceの接続間隔の整数倍か整数分の1が要求の範囲に入る時は、範囲の代わりにその間隔にする
+    // 間隔が倍数同士なら2つの接続の接続イベントのずれは一定になり、重なり続けることも無くなる
+    // referenceの間隔が変わった時はこちらも要求し直す、セントラル側の接続に使う
+    void alignTo(LinkManager &reference);
+
+    // referenceの間隔(1.25ms単位)の整数倍か整数分の1で、minからmaxの範囲に入る物
+    // preferShortなら範囲に入る一番短い物、そうでなければ一番長い物
+    // 範囲に入る物が無ければ0で、その時は合わせずに範囲のまま要求する
+    static uint16_t alignedInterval(uint16_t reference, uint16_t min, uint16_t max, bool preferShort);
+
+    // loopTaskから、確認用のタイマーを開始する
+    void start();
+
+    // BLEのコールバックから、接続した時はACTIVEのパラメーターで繋がっている
+    void connected(uint16_t connHandle);
+    void disconnected();
+
+    // BLEのイベントから、接続した時とパラメーターが変わった時の実際のパラメーター
+    // 覚えておくだけで、間隔を合わせ直す要求は次のkeyActivityかonTimerでloopTaskから出す
+    void updated(const ble_gap_conn_params_t &params);
+
+    uint16_t connHandle() const {
+        return _connHandle;
+    }
+
+    // 今の接続間隔 (1.25ms単位)、接続していなければ0
+    uint16_t interval() const {
+        return _interval;
+    }
+
+    // loopTaskから、キーの状態が変化した時に呼ぶ
+    void keyActivity();
+
+    // loopTaskから、idleTimeoutごとにIDLEにするか確認して、変化があれば間隔を合わせ直す
+    void onTimer() override;
+
+    const LinkStats &stats() const {
+        return _stats;
+    }
+
+  private:
+    // BLEのタスクから知らされた接続とパラメーターの変化をloopTaskで反映する
+    // 要求を出すのも統計と_isIdleを書き換えるのもloopTaskだけにする
+    void applyUpdates();
+    void request(bool isIdle);
+    // alignToした接続の間隔に合っていなければ要求し直す
+    void realign();
+
+    const LinkPolicy &_policy;
+    LinkManager *_reference = nullptr;
+    LinkManager *_follower = nullptr;
+    volatile uint16_t _connHandle;
+    volatile uint16_t _interval = 0;
+    volatile bool _isReconnected = false;
+    volatile bool _needsRealign = false;
+    bool _isIdle;
+    Timestamp _lastActivity;
+    LinkStats _stats;
+};
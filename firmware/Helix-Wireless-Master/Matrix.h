@@ -0,0 +1,119 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+// キーマトリックスの形をコンパイル時に決めるためのテンプレート
+// ピン番号をテンプレート引数で持つので、マスクはコンパイル時に計算されて
+// スキャンは行と列の数だけ展開された定数のシフトとマスクになる
+
+namespace matrix_detail {
+
+constexpr uint32_t pinsMask() {
+    return 0;
+}
+
+template <typename... Rest>
+constexpr uint32_t pinsMask(uint8_t first, Rest... rest) {
+    return (1UL << first) | pinsMask(rest...);
+}
+
+// ids[o][i]が0以外の所のビット(o * I + i)を1にする、nは残りの要素数
+template <size_t O, size_t I>
+constexpr uint64_t nonZeroMask(const uint8_t (&ids)[O][I], size_t n = O * I) {
+    return n == 0 ? 0 : ((ids[(n - 1) / I][(n - 1) % I] != 0 ? (1ULL << (n - 1)) : 0) | nonZeroMask(ids, n - 1));
+}
+
+// ポートのPinsのビットを集めてIndexビット目から詰めて並べる
+template <uint8_t Index, uint8_t... Pins>
+struct Gather {
+    static inline uint32_t apply(uint32_t port) {
+        return 0;
+    }
+};
+
+template <uint8_t Index, uint8_t First, uint8_t... Rest>
+struct Gather<Index, First, Rest...> {
+    static inline uint32_t apply(uint32_t port) {
+        return (((port >> First) & 1) << Index) | Gather<Index + 1, Rest...>::apply(port);
+    }
+};
+
+// 1行ずつreadRowで読んでRow * Inputs::SIZEビット目から並べる
+template <typename Inputs, uint8_t Row, uint8_t... OutputPins>
+struct ScanRows {
+    template <typename ReadRow>
+    static inline uint64_t apply(ReadRow &readRow) {
+        return 0;
+    }
+};
+
+template <typename Inputs, uint8_t Row, uint8_t First, uint8_t... Rest>
+struct ScanRows<Inputs, Row, First, Rest...> {
+    template <typename ReadRow>
+    static inline uint64_t apply(ReadRow &readRow) {
+        uint64_t row = Inputs::gather(readRow(1UL << First));
+        return (row << (Row * Inputs::SIZE)) | ScanRows<Inputs, Row + 1, Rest...>::apply(readRow);
+    }
+};
+
+} // namespace matrix_detail
+
+// ピンのリスト
+template <uint8_t... Pins>
+struct PinList {
+    static constexpr uint8_t SIZE = sizeof...(Pins);
+    static constexpr uint8_t pins[SIZE] = {Pins...};
+    static constexpr uint32_t MASK = matrix_detail::pinsMask(Pins...);
+
+    // ポートの値からこのリストのピンのビットを集めて、i番目のピンをiビット目にする
+    static inline uint32_t gather(uint32_t port) {
+        return matrix_detail::Gather<0, Pins...>::apply(port);
+    }
+};
+
+template <uint8_t... Pins>
+constexpr uint8_t PinList<Pins...>::pins[];
+
+// 出力ピン(行)と入力ピン(列)のマトリックス、スキャン結果のビット位置は(行 * INPUTS_SIZE + 列)
+template <typename Outputs, typename Inputs>
+struct Matrix;
+
+template <uint8_t... OutputPins, typename Inputs>
+struct Matrix<PinList<OutputPins...>, Inputs> {
+    typedef PinList<OutputPins...> Outputs;
+
+    static constexpr uint8_t OUTPUTS_SIZE = Outputs::SIZE;
+    static constexpr uint8_t INPUTS_SIZE = Inputs::SIZE;
+    static constexpr uint8_t SIZE = OUTPUTS_SIZE * INPUTS_SIZE;
+    static_assert(SIZE <= 64, "matrix must fit in 64 bits");
+
+    // 1行ずつreadRow(行の出力ピンのマスク)を呼び出して、戻り値のポートの値からマトリックス全体のビットを作る
+    template <typename ReadRow>
+    static inline uint64_t scan(ReadRow readRow) {
+        return matrix_detail::ScanRows<Inputs, 0, OutputPins...>::apply(readRow);
+    }
+};
@@ -0,0 +1,103 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "PortSense.h"
+
+PortSense portSense;
+
+void PortSense::init(const uint8_t *pins, uint8_t size, void (*callback)(BaseType_t *woken)) {
+    _callback = callback;
+
+    // ピンの設定は残したままSENSEだけLowにする
+    _pinsMask = 0;
+    for (int i = 0; i < size; i++) {
+        _pinsMask |= bit(pins[i]);
+        uint32_t cnf = NRF_GPIO->PIN_CNF[pins[i]];
+        cnf &= ~GPIO_PIN_CNF_SENSE_Msk;
+        cnf |= (GPIO_PIN_CNF_SENSE_Low << GPIO_PIN_CNF_SENSE_Pos);
+        NRF_GPIO->PIN_CNF[pins[i]] = cnf;
+    }
+
+    // DETECT信号の立ち上がりでPORTイベント、割り込みはarmするまで無効
+    NRF_GPIOTE->INTENCLR = GPIOTE_INTENCLR_PORT_Msk;
+    NRF_GPIOTE->EVENTS_PORT = 0;
+
+    // SoftDeviceとFreeRTOSのAPIが使える範囲
+    NVIC_SetPriority(GPIOTE_IRQn, 3);
+    NVIC_ClearPendingIRQ(GPIOTE_IRQn);
+    NVIC_EnableIRQ(GPIOTE_IRQn);
+}
+
+bool PortSense::arm() {
+    NRF_GPIOTE->EVENTS_PORT = 0;
+    NRF_GPIOTE->INTENSET = GPIOTE_INTENSET_PORT_Msk;
+    // 有効にする前からLowだったピンはイベントにならないので、有効にした後で確認する
+    // 確認より後でLowになった物はPORTイベントになる
+    if ((~NRF_GPIO->IN & _pinsMask) != 0) {
+        disarm();
+        return false;
+    }
+    return true;
+}
+
+void PortSense::disarm() {
+    NRF_GPIOTE->INTENCLR = GPIOTE_INTENCLR_PORT_Msk;
+    NRF_GPIOTE->EVENTS_PORT = 0;
+    NVIC_ClearPendingIRQ(GPIOTE_IRQn);
+}
+
+void PortSense::countMaskedEvent() {
+    if (NRF_GPIOTE->EVENTS_PORT != 0) {
+        NRF_GPIOTE->EVENTS_PORT = 0;
+        _maskedEventCount++;
+    }
+}
+
+uint32_t PortSense::maskedEventCount() const {
+    return _maskedEventCount;
+}
+
+void PortSense::onPortEvent() {
+    if (NRF_GPIOTE->EVENTS_PORT == 0) {
+        return;
+    }
+    // 1回だけ、次はarmされるまで発生させない
+    NRF_GPIOTE->INTENCLR = GPIOTE_INTENCLR_PORT_Msk;
+    NRF_GPIOTE->EVENTS_PORT = 0;
+    // イベントのクリアが反映される前に割り込みから抜けると再度割り込みが入るので読み戻す
+    (void)NRF_GPIOTE->EVENTS_PORT;
+
+    BaseType_t woken = pdFALSE;
+    if (_callback != nullptr) {
+        _callback(&woken);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+// Adafruit nRF52のコア0.8系ではcores/nRF5/WInterrupts.cがGPIOTE_IRQHandlerをweakではなく定義している
+// コアはアーカイブからリンクされるので、attachInterrupt、detachInterruptを呼ばなければWInterrupts.oはリンクされずこちらが使われる
+// 呼ぶ物があればGPIOTE_IRQHandlerの二重定義でリンクが失敗し、黙ってどちらかの割り込みが動かなくなることは無い
+extern "C" void GPIOTE_IRQHandler(void) {
+    portSense.onPortEvent();
+}
@@ -0,0 +1,66 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+// GPIOTE_IRQHandlerを自前で定義するので、コアのattachInterrupt、detachInterruptは使えない
+// 使うとコアのGPIOTE_IRQHandlerと二重定義になるので、ここでコンパイルエラーにしておく
+#pragma GCC poison attachInterrupt detachInterrupt
+
+// GPIOのSENSE機能とGPIOTEのPORTイベントでキー入力を待つクラス
+// attachInterruptはピンごとにGPIOTEのINチャンネルを使いHFCLKを要求し続けるので、
+// 代わりに入力ピン全部にSENSE(Low)を設定して、どれか1つがLowになった時に1回だけPORTイベントで起きる
+// コアのGPIOTE_IRQHandlerはINチャンネルのイベントしか見ずPORTイベントを扱うフックも無いので、割り込みハンドラは自前で持つ
+// 割り込みは1回発生すると無効になり、armで再度有効にするまでは発生しない
+// スキャン中は行の切り替えのたびにPORTイベントが発生するので、その間は割り込みを無効にしておく
+class PortSense {
+  public:
+    // pinsのピンがLowになったら割り込みハンドラからcallbackを呼ぶ、最初は無効
+    void init(const uint8_t *pins, uint8_t size, void (*callback)(BaseType_t *woken));
+
+    // 割り込みを有効にする
+    // 既にどれかのピンがLowの時はPORTイベントが発生しないので、有効にせずにfalseを返す
+    bool arm();
+
+    // 割り込みを無効にする
+    void disarm();
+
+    // 割り込みを無効にしている間に発生したPORTイベントを数えてクリアする
+    void countMaskedEvent();
+
+    // 無効にしていたおかげで発生しなかった割り込みの回数
+    uint32_t maskedEventCount() const;
+
+    // 割り込みハンドラから呼ばれる
+    void onPortEvent();
+
+  private:
+    void (*_callback)(BaseType_t *woken) = nullptr;
+    uint32_t _pinsMask = 0;
+    uint32_t _maskedEventCount = 0;
+};
+
+extern PortSense portSense;
@@ -0,0 +1,63 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "RadioNotification.h"
+#include <nrf_soc.h>
+
+RadioNotification radioNotification;
+
+void RadioNotification::init(void (*callback)(BaseType_t *woken)) {
+    _callback = callback;
+
+    // 無線が動き出す前(ACTIVE信号)だけ通知してもらう
+    sd_radio_notification_cfg_set(NRF_RADIO_NOTIFICATION_TYPE_INT_ON_ACTIVE, NRF_RADIO_NOTIFICATION_DISTANCE_1740US);
+
+    // SoftDeviceとFreeRTOSのAPIが使える範囲
+    NVIC_SetPriority(RADIO_NOTIFICATION_IRQn, 3);
+    NVIC_ClearPendingIRQ(RADIO_NOTIFICATION_IRQn);
+    NVIC_EnableIRQ(RADIO_NOTIFICATION_IRQn);
+}
+
+bool RadioNotification::lastNotification(Timestamp &time) const {
+    if (_hasNotified == false) {
+        return false;
+    }
+    time = _lastTime;
+    return true;
+}
+
+void RadioNotification::onInterrupt() {
+    _lastTime = currentTimestamp();
+    _hasNotified = true;
+
+    BaseType_t woken = pdFALSE;
+    if (_callback != nullptr) {
+        _callback(&woken);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+extern "C" void RADIO_NOTIFICATION_IRQHandler(void) {
+    radioNotification.onInterrupt();
+}
@@ -0,0 +1,143 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "ScanTimer.h"
+
+ScanTimer scanTimer;
+
+// RTC0はSoftDevice、RTC1はFreeRTOSのtickで使われているのでRTC2を使う
+#define SCAN_RTC NRF_RTC2
+#define SCAN_RTC_IRQn RTC2_IRQn
+
+const static uint32_t RTC_FREQUENCY = TIMESTAMP_FREQUENCY;
+const static uint32_t RTC_COUNTER_BITS = 24;
+const static uint32_t RTC_COUNTER_MASK = 0xFFFFFF;
+// CCにCOUNTER+2未満を書くとコンペアイベントが発生しない
+const static uint32_t RTC_MIN_COMPARE_DISTANCE = 2;
+
+void ScanTimer::init(void (*callback)(BaseType_t *woken), uint32_t periodUs) {
+    _callback = callback;
+    setPeriod(periodUs);
+
+    // PRESCALER 0で32768Hz、カウンターは止めずに動かしておく
+    SCAN_RTC->TASKS_STOP = 1;
+    SCAN_RTC->PRESCALER = 0;
+    SCAN_RTC->EVTENCLR = RTC_EVTEN_COMPARE0_Msk;
+    SCAN_RTC->INTENCLR = RTC_INTENCLR_COMPARE0_Msk;
+    SCAN_RTC->EVENTS_COMPARE[0] = 0;
+    // 時刻を32ビットに拡張するためにオーバーフローを数える
+    SCAN_RTC->EVENTS_OVRFLW = 0;
+    SCAN_RTC->INTENSET = RTC_INTENSET_OVRFLW_Msk;
+    SCAN_RTC->TASKS_CLEAR = 1;
+    SCAN_RTC->TASKS_START = 1;
+
+    // GPIOTEと同じ優先度、SoftDeviceとFreeRTOSのAPIが使える範囲
+    NVIC_SetPriority(SCAN_RTC_IRQn, 3);
+    NVIC_ClearPendingIRQ(SCAN_RTC_IRQn);
+    NVIC_EnableIRQ(SCAN_RTC_IRQn);
+}
+
+void ScanTimer::start() {
+    if (_running) {
+        return;
+    }
+    _running = true;
+    _nextQ8 = (SCAN_RTC->COUNTER << 8) + _periodQ8;
+    SCAN_RTC->CC[0] = (_nextQ8 >> 8) & RTC_COUNTER_MASK;
+    SCAN_RTC->EVENTS_COMPARE[0] = 0;
+    SCAN_RTC->INTENSET = RTC_INTENSET_COMPARE0_Msk;
+}
+
+void ScanTimer::stop() {
+    _running = false;
+    SCAN_RTC->INTENCLR = RTC_INTENCLR_COMPARE0_Msk;
+    SCAN_RTC->EVENTS_COMPARE[0] = 0;
+}
+
+void ScanTimer::setPeriod(uint32_t periodUs) {
+    _periodUs = periodUs;
+    _periodQ8 = (uint32_t)(((uint64_t)periodUs * RTC_FREQUENCY * 256 + 500000) / 1000000);
+}
+
+uint32_t ScanTimer::period() const {
+    return _periodUs;
+}
+
+Timestamp ScanTimer::timestamp() const {
+    uint32_t overflows, counter;
+    bool pending;
+    // 途中で割り込みハンドラがオーバーフローを数えたら読み直す
+    do {
+        overflows = _overflows;
+        counter = SCAN_RTC->COUNTER;
+        pending = SCAN_RTC->EVENTS_OVRFLW != 0;
+    } while (overflows != _overflows);
+    // 割り込みハンドラがまだ数えていないオーバーフロー
+    // カウンターを読んだ後でオーバーフローした場合はカウンターが最大値付近なので数えない
+    if (pending && counter < (RTC_COUNTER_MASK >> 1)) {
+        overflows++;
+    }
+    return (overflows << RTC_COUNTER_BITS) | counter;
+}
+
+void ScanTimer::onInterrupt() {
+    if (SCAN_RTC->EVENTS_OVRFLW != 0) {
+        SCAN_RTC->EVENTS_OVRFLW = 0;
+        (void)SCAN_RTC->EVENTS_OVRFLW;
+        _overflows++;
+    }
+    if (SCAN_RTC->EVENTS_COMPARE[0] == 0) {
+        return;
+    }
+    SCAN_RTC->EVENTS_COMPARE[0] = 0;
+    // イベントのクリアが反映される前に割り込みから抜けると再度割り込みが入るので読み戻す
+    (void)SCAN_RTC->EVENTS_COMPARE[0];
+    if (_running == false) {
+        return;
+    }
+
+    // 前回のコンペア時刻に周期を足して次を決める
+    _nextQ8 += _periodQ8;
+    uint32_t counter = SCAN_RTC->COUNTER;
+    uint32_t distance = ((_nextQ8 >> 8) - counter) & RTC_COUNTER_MASK;
+    // 割り込みが遅れて次の時刻を過ぎていたら今から1周期後に合わせ直す
+    if (distance < RTC_MIN_COMPARE_DISTANCE || distance > (RTC_COUNTER_MASK >> 1)) {
+        _nextQ8 = (counter << 8) + _periodQ8;
+    }
+    SCAN_RTC->CC[0] = (_nextQ8 >> 8) & RTC_COUNTER_MASK;
+
+    BaseType_t woken = pdFALSE;
+    if (_callback != nullptr) {
+        _callback(&woken);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+extern "C" void RTC2_IRQHandler(void) {
+    scanTimer.onInterrupt();
+}
+
+Timestamp currentTimestamp() {
+    return scanTimer.timestamp();
+}
@@ -0,0 +1,61 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "SplitClientService.h"
+
+SplitClientService::SplitClientService()
+    : BLEClientService(SPLIT_SERVICE_UUID), _frame(SPLIT_FRAME_CHR_UUID) {
+}
+
+bool SplitClientService::begin() {
+    VERIFY(BLEClientService::begin());
+
+    _frame.begin();
+    _frame.setNotifyCallback(frame_notify_callback);
+
+    return true;
+}
+
+bool SplitClientService::discover(uint16_t conn_handle) {
+    VERIFY(BLEClientService::discover(conn_handle));
+    _conn_hdl = BLE_CONN_HANDLE_INVALID;
+
+    VERIFY(Bluefruit.Discovery.discoverCharacteristic(conn_handle, _frame) == 1);
+
+    _conn_hdl = conn_handle;
+    return true;
+}
+
+bool SplitClientService::enableNotify() {
+    return _frame.enableNotify();
+}
+
+bool SplitClientService::send(const uint8_t *frame, size_t size) {
+    return _frame.write(frame, size) == size;
+}
+
+void SplitClientService::frame_notify_callback(BLEClientCharacteristic *chr, uint8_t *data, uint16_t len) {
+    SplitClientService &svc = (SplitClientService &)chr->parentService();
+    svc.received(data, len);
+}
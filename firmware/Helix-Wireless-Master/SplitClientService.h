@@ -0,0 +1,50 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "SplitLink.h"
+#include "SplitProtocol.h"
+#include <bluefruit.h>
+
+// スレーブ側のSplitServiceに繋ぐクライアント、SplitLinkのマスター側のBLEの実装
+// 通知で受け取ったバッファをそのまま受け取りのコールバックに渡すので、フレームはコピーせずにその場で読める
+// 受け取りのコールバックはBLEのタスクから呼ばれる
+class SplitClientService : public BLEClientService, public SplitLink {
+  public:
+    SplitClientService();
+
+    virtual bool begin();
+    virtual bool discover(uint16_t conn_handle);
+
+    bool enableNotify();
+
+    // スレーブ側にフレームを1つ送る
+    bool send(const uint8_t *frame, size_t size) override;
+
+  private:
+    static void frame_notify_callback(BLEClientCharacteristic *chr, uint8_t *data, uint16_t len);
+
+    BLEClientCharacteristic _frame;
+};
@@ -0,0 +1,74 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+// スレーブとマスターの間でフレーム(SplitProtocol.h)をやり取りする経路
+// 1回のsendで送ったフレームは、相手側で1回のreceiveコールバックでそのまま受け取る
+// 実装はBLEのGATTサービス(スレーブ側のSplitService、マスター側のSplitClientService)と、ホストのシミュレーター用のループバック
+class SplitLink {
+  public:
+    typedef void (*receive_callback_t)(const uint8_t *frame, size_t size);
+    typedef void (*connection_callback_t)(bool isConnected);
+
+    // フレームを1つ送る、繋がっていないか送れなければfalse
+    virtual bool send(const uint8_t *frame, size_t size) = 0;
+
+    bool isConnected() const {
+        return _isConnected;
+    }
+
+    // フレームを受け取った時に呼ばれる
+    void setReceiveCallback(receive_callback_t fp) {
+        _receiveCallback = fp;
+    }
+
+    // 相手側と繋がった時と切れた時に呼ばれる
+    void setConnectionCallback(connection_callback_t fp) {
+        _connectionCallback = fp;
+    }
+
+    // 実装か実装を持っている側から、フレームをやり取りできるようになった時と切れた時に呼ぶ
+    void setConnected(bool isConnected) {
+        _isConnected = isConnected;
+        if (_connectionCallback != nullptr) {
+            _connectionCallback(isConnected);
+        }
+    }
+
+  protected:
+    // 実装から、フレームを受け取った時に呼ぶ
+    void received(const uint8_t *frame, size_t size) {
+        if (_receiveCallback != nullptr) {
+            _receiveCallback(frame, size);
+        }
+    }
+
+  private:
+    receive_callback_t _receiveCallback = nullptr;
+    connection_callback_t _connectionCallback = nullptr;
+    volatile bool _isConnected = false;
+};
@@ -39,6 +39,28 @@
 // BLEの送信電波強度: -40, -30, -20, -16, -12, -8, -4, 0, 4
 #define TX_POWER -4
 
+// 接続ごとのコネクションパラメーター、間隔は1.25ms単位
+// キー入力がある間はACTIVEの間隔にして、LINK_IDLE_TIMEOUT(ms)の間キー入力が無ければIDLEの間隔とスレーブレイテンシにする
+// IDLEの間に最初のキー入力があればすぐにACTIVEに戻す
+#define LINK_IDLE_TIMEOUT 5000
+// PCとの接続 (ACTIVEはBLEHidAdafruit::begin()と同じ11.25 - 15ms)
+#define HOST_LINK_ACTIVE_INTERVAL_MIN 9
+#define HOST_LINK_ACTIVE_INTERVAL_MAX 12
+#define HOST_LINK_IDLE_INTERVAL_MIN 24
+#define HOST_LINK_IDLE_INTERVAL_MAX 36
+#define HOST_LINK_IDLE_SLAVE_LATENCY 4
+// スレーブ側との接続
+// PCとの接続の間隔が分かっている時は、その整数倍か整数分の1がこの範囲に入ればその間隔にする
+// 範囲に入る物が無ければ合わせずにこの範囲のまま
+// 既定の範囲では倍数か約数の関係になる組み合わせが少なく、合わせようとしても何もしないことが多い
+// ACTIVE同士はPCが15ms(12)の時の7.5ms(6)だけで、PCが11.25 - 13.75ms(9 - 11)なら合わせる間隔が無い
+// IDLE同士もPCが30ms(24)の時の60ms(48)だけ、PCがACTIVEでこちらがIDLEの時はPCの9 - 12に45、40、44、48で合わせられる
+#define SPLIT_LINK_ACTIVE_INTERVAL_MIN 6
+#define SPLIT_LINK_ACTIVE_INTERVAL_MAX 8
+#define SPLIT_LINK_IDLE_INTERVAL_MIN 40
+#define SPLIT_LINK_IDLE_INTERVAL_MAX 48
+#define SPLIT_LINK_IDLE_SLAVE_LATENCY 4
+
 // LEDの点滅間隔、省電力のためにOFFの方を長めにしてある (ms)
 #define TURN_ON_INTERVAL 100
 #define TURN_OFF_INTERVAL 800
@@ -46,6 +68,33 @@
 // cherry mx bounce time is <= 5ms
 #define DEBOUNCE_DELAY 6
 
+// キースキャン中のスキャン周期の初期値 (us)、setScanPeriodで実行時に変更できる
+#define SCAN_PERIOD 3000
+
+// キーが押されたまま変化が無い時は、SCAN_BACKOFF_TIME(ms)ごとにスキャン周期を倍にしていく
+// 最大でSCAN_BACKOFF_LEVELS回まで倍にする
+#define SCAN_BACKOFF_TIME 50
+#define SCAN_BACKOFF_LEVELS 3
+
+// 最初のキー入力からこの時間(ms)内に届いたキー入力をまとめて1つのレポートで送る、0ならその時溜まっている分だけまとめる
+// 左右同時押しをスレーブ側の遅れを待って1つのレポートにしたい時に数msを設定する
+#define COALESCING_WINDOW 0
+
+// スレーブ側と時計を合わせる間隔 (ms)
+#define TIME_SYNC_INTERVAL 1000
+
+// スレーブ側のキーが押されている間にこの時間(ms)フレームが届かなければ、切断を待たずに全部離す
+// スレーブ側はキーが押されている間HEARTBEAT_INTERVAL(200ms)ごとに何か送るので、その3回分にしてある
+// 確かめる間隔はこの1/4なので、止まってから離すまでは最大でこの1.25倍
+#define SPLIT_WATCHDOG_TIMEOUT 600
+
+// マスター側のキー入力をこの時間(ms)だけ待たせて、その間に届いたスレーブ側のもっと前の入力を先に処理する
+// スレーブ側の遅れ(接続間隔くらい)を設定すると左右を跨いだ速い入力も押した順番通りになるが、マスター側のキーがその分遅れる
+// ホストのシミュレーター(Helix-Wireless-HostSim)の確認ではビルド時に変えている
+#ifndef SPLIT_REORDER_WINDOW
+#define SPLIT_REORDER_WINDOW 0
+#endif
+
 // レイヤーのサイズ
 #define LAYER_SIZE 8
 
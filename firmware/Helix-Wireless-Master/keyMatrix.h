@@ -0,0 +1,85 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+// このファイルはkeyScan.cppからだけincludeする
+
+#include "Debouncer.h"
+#include "Matrix.h"
+#include "config.h"
+
+// マトリックス回路で使うピンの定義
+typedef PinList<
+    4,  // ROW0
+    11, // ROW1
+    12, // ROW2
+    14, // ROW3
+    16  // ROW4
+    >
+    OutputPins;
+
+typedef PinList<
+    13, // COL0
+    15, // COL1
+    31, // COL2
+    30, // COL3
+    29, // COL4
+    28, // COL5
+    27  // COL6
+    >
+    InputPins;
+
+typedef Matrix<OutputPins, InputPins> KeyMatrix;
+
+// スイッチとマトリックスの定義
+// 論理的なキーID(1~255(0からではない))、スイッチが無い所は0
+static constexpr uint8_t keyIDs[KeyMatrix::OUTPUTS_SIZE][KeyMatrix::INPUTS_SIZE] = {
+    { 1,  2,  3,  4,  5,  6,  0},
+    {13, 14, 15, 16, 17, 18,  0},
+    {25, 26, 27, 28, 29, 30,  0},
+    {37, 38, 39, 40, 41, 42, 43},
+    {51, 52, 53, 54, 55, 56, 57},
+};
+
+// スイッチごとのチャタリング除去の方式、keyIDsと同じ並び
+//   DEFER(ms)            : 入力がmsの間変化しなかったら確定する
+//   EAGER(ms)            : 最初の変化ですぐ確定して、その後msの間は入力を無視する (押してからの遅延が無い)
+//   ASYM(press, release) : 押した時と離した時で確定までの時間(ms)を変える
+// 文字のキーとスペースはEAGERで押してからの遅延を無くす
+// 修飾キーとレイヤーキーは同時押しの途中で離れたと誤判定すると別のキーコードになるので、押す時は短く離す時は長く確定させる
+// それ以外(数字の行、Tab、Esc、EISUなど)は今まで通りDEFER
+#define D DEFER(DEBOUNCE_DELAY)
+#define E EAGER(DEBOUNCE_DELAY)
+#define A ASYM(DEBOUNCE_DELAY / 2, DEBOUNCE_DELAY * 2)
+static constexpr DebouncePolicy debouncePolicies[KeyMatrix::OUTPUTS_SIZE][KeyMatrix::INPUTS_SIZE] = {
+    {D, D, D, D, D, D, D},
+    {D, E, E, E, E, E, D},
+    {A, E, E, E, E, E, D},
+    {A, E, E, E, E, E, D},
+    {D, D, A, A, D, A, E},
+};
+#undef D
+#undef E
+#undef A
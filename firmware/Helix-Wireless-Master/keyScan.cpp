@@ -23,93 +23,86 @@
 */
 
 #include "keyScan.h"
-#include "Switch.h"
-#include "UInt8Set.h"
+#include "Debouncer.h"
+#include "PortSense.h"
+#include "ScanGovernor.h"
+#include "ScanTimer.h"
+#include "config.h"
+#include "keyMatrix.h"
 #include "queues.h"
 
-// マトリックス回路で使うピンの定義
-const static uint8_t OUT0 = 4;  // ROW0
-const static uint8_t OUT1 = 11; // ROW1
-const static uint8_t OUT2 = 12; // ROW2
-const static uint8_t OUT3 = 14; // ROW3
-const static uint8_t OUT4 = 16; // ROW4
-const static uint8_t outputs[] = {OUT0, OUT1, OUT2, OUT3, OUT4};
-
-const static uint8_t IN0 = 13; // COL0
-const static uint8_t IN1 = 15; // COL1
-const static uint8_t IN2 = 31; // COL2
-const static uint8_t IN3 = 30; // COL3
-const static uint8_t IN4 = 29; // COL4
-const static uint8_t IN5 = 28; // COL5
-const static uint8_t IN6 = 27; // COL6
-const static uint8_t inputs[] = {IN0, IN1, IN2, IN3, IN4, IN5, IN6};
-
-// スイッチとマトリックスの定義
-// Switch(pin, id)
-static Switch sw1(IN0, 1);
-static Switch sw2(IN1, 2);
-static Switch sw3(IN2, 3);
-static Switch sw4(IN3, 4);
-static Switch sw5(IN4, 5);
-static Switch sw6(IN5, 6);
-
-static Switch sw7(IN0, 13);
-static Switch sw8(IN1, 14);
-static Switch sw9(IN2, 15);
-static Switch sw10(IN3, 16);
-static Switch sw11(IN4, 17);
-static Switch sw12(IN5, 18);
-
-static Switch sw13(IN0, 25);
-static Switch sw14(IN1, 26);
-static Switch sw15(IN2, 27);
-static Switch sw16(IN3, 28);
-static Switch sw17(IN4, 29);
-static Switch sw18(IN5, 30);
-
-static Switch sw19(IN0, 37);
-static Switch sw20(IN1, 38);
-static Switch sw21(IN2, 39);
-static Switch sw22(IN3, 40);
-static Switch sw23(IN4, 41);
-static Switch sw24(IN5, 42);
-static Switch sw25(IN6, 43);
-
-static Switch sw26(IN0, 51);
-static Switch sw27(IN1, 52);
-static Switch sw28(IN2, 53);
-static Switch sw29(IN3, 54);
-static Switch sw30(IN4, 55);
-static Switch sw31(IN5, 56);
-static Switch sw32(IN6, 57);
-
-const static uint8_t OUTPUTS_SIZE = sizeof(outputs) / sizeof(outputs[0]);
-const static uint8_t INPUTS_SIZE = sizeof(inputs) / sizeof(inputs[0]);
-
-static Switch *switches[OUTPUTS_SIZE][INPUTS_SIZE] = {
-    {&sw1,  &sw2,  &sw3,  &sw4,  &sw5,  &sw6,  nullptr},
-    {&sw7,  &sw8,  &sw9,  &sw10, &sw11, &sw12, nullptr},
-    {&sw13, &sw14, &sw15, &sw16, &sw17, &sw18, nullptr},
-    {&sw19, &sw20, &sw21, &sw22, &sw23, &sw24, &sw25},
-    {&sw26, &sw27, &sw28, &sw29, &sw30, &sw31, &sw32},
-};
+// スキャン結果のビット位置(o * INPUTS_SIZE + i)とキーIDの対応
+static const uint8_t *const bitToKeyID = &keyIDs[0][0];
+
+// スイッチが存在するビット
+static constexpr uint64_t validMask = matrix_detail::nonZeroMask(keyIDs);
+
+static Debouncer debouncer;
+static ScanGovernor governor;
+
+// 実行時に変更されたスキャン周期 (us)、keyScanTaskで反映する
+static volatile uint32_t requestedScanPeriod = SCAN_PERIOD;
+
+// 出力を切り替えてから入力ピンの電圧が安定するまでの待ち時間 (us)
+const static uint32_t SETTLE_DELAY_US = 1;
 
 // 割り込み用
 // 省電力のために常にポーリングはせずに、キー入力割り込みで起きて入力が無くなったら寝るを繰り返す
+// スキャン中は割り込みを無効にしておき、寝る直前に有効にする
 static uint8_t tmp;
-static volatile bool isInterrupted = false;
 static QueueHandle_t keyInterruptQueue;
+// スキャン周期ごとの通知
+static QueueHandle_t scanTickQueue;
 
 // 起きる
-static void key_interrupt_callback() {
-    isInterrupted = true;
-    xQueueOverwriteFromISR(keyInterruptQueue, &tmp, NULL);
+static void key_interrupt_callback(BaseType_t *woken) {
+    xQueueOverwriteFromISR(keyInterruptQueue, &tmp, woken);
+}
+
+// スキャンの時間
+static void scan_tick_callback(BaseType_t *woken) {
+    xQueueOverwriteFromISR(scanTickQueue, &tmp, woken);
 }
 
 // 出力ピンを一括設定
 static inline void outputsWrite(int val) {
-    for (int i = 0; i < OUTPUTS_SIZE; i++) {
-        digitalWrite(outputs[i], val);
+    if (val == HIGH) {
+        NRF_GPIO->OUTSET = OutputPins::MASK;
+    } else {
+        NRF_GPIO->OUTCLR = OutputPins::MASK;
+    }
+}
+
+// 1行分スキャンする、行の出力をLOWにしてポートの入力を1回だけ読む
+// 戻り値はアクティブローを反転した物なので押されているスイッチのビットが1になる
+static inline uint32_t readRow(uint32_t outputMask) {
+    NRF_GPIO->OUTCLR = outputMask;
+    delayMicroseconds(SETTLE_DELAY_US);
+    uint32_t port = ~(NRF_GPIO->IN);
+    NRF_GPIO->OUTSET = outputMask;
+    // 押されているスイッチがあるとこの行の切り替えでPORTイベントが発生している
+    portSense.countMaskedEvent();
+    return port;
+}
+
+// マトリックス全体をスキャンして押されているスイッチのビットを1にして返す
+static uint64_t scanMatrix() {
+    outputsWrite(HIGH);
+    // 行と列の数だけ展開される
+    uint64_t raw = KeyMatrix::scan(readRow);
+    // 割り込みのために出力をLOWに設定
+    outputsWrite(LOW);
+    return raw & validMask;
+}
+
+// スキャン周期を反映する、チャタリング除去の回数も周期に合わせて計算し直す
+static void applyScanPeriod(uint32_t period) {
+    scanTimer.setPeriod(period);
+    // スイッチごとにチャタリング除去の方式を設定
+    for (int o = 0; o < KeyMatrix::OUTPUTS_SIZE; o++) {
+        for (int i = 0; i < KeyMatrix::INPUTS_SIZE; i++) {
+            debouncer.setPolicy(o * KeyMatrix::INPUTS_SIZE + i, debouncePolicies[o][i], period);
+        }
     }
 }
 
@@ -117,88 +110,92 @@ static inline void outputsWrite(int val) {
 static void initMatrix() {
     // サイズが1のキューを通知代わりに使用する
     keyInterruptQueue = xQueueCreate(1, sizeof(tmp));
+    scanTickQueue = xQueueCreate(1, sizeof(tmp));
+    governor.setBasePeriod(requestedScanPeriod);
+    scanTimer.init(scan_tick_callback, governor.period());
+    applyScanPeriod(governor.period());
     // ピンの入力、出力設定
-    for (int i = 0; i < OUTPUTS_SIZE; i++) {
-        pinMode(outputs[i], OUTPUT);
-        digitalWrite(outputs[i], LOW);
+    for (int i = 0; i < OutputPins::SIZE; i++) {
+        pinMode(OutputPins::pins[i], OUTPUT);
+        digitalWrite(OutputPins::pins[i], LOW);
     }
     // アクティブロー
-    for (int i = 0; i < INPUTS_SIZE; i++) {
-        pinMode(inputs[i], INPUT_PULLUP);
-        attachInterrupt(inputs[i], key_interrupt_callback, FALLING);
-    }
-    // スイッチオブジェクトの初期化
-    for (int o = 0; o < OUTPUTS_SIZE; o++) {
-        for (int i = 0; i < INPUTS_SIZE; i++) {
-            if (switches[o][i] == nullptr) {
-                continue;
-            }
-            switches[o][i]->init();
-        }
-    }
-}
-
-// 割り込みが発生してから+(DEBOUNCE_DELAY * 3)msまでの間はキースキャンする。
-// キー押し時はキースキャン中に入力ピンの電圧が変わるので押されてる限り割り込みが発生し続ける
-static bool needsKeyScan() {
-    static unsigned long lastInterruptMillis = 0;
-
-    // 割り込みされたら
-    if (isInterrupted) {
-        lastInterruptMillis = millis();
-        isInterrupted = false;
-        return true;
+    for (int i = 0; i < InputPins::SIZE; i++) {
+        pinMode(InputPins::pins[i], INPUT_PULLUP);
     }
-    // 最後に押されてた時間から今の時間までを計算して
-    unsigned long currentMillis = millis();
-    if ((unsigned long)(currentMillis - lastInterruptMillis) <= (DEBOUNCE_DELAY * 3)) {
-        return true;
-    }
-    return false;
+    // どれかの入力がLowになったら1つのPORTイベントで起きる
+    portSense.init(InputPins::pins, InputPins::SIZE, key_interrupt_callback);
 }
 
 static void keyScanTask(void *arg) {
-    EventData data = {
-        .eventType = SCAN_KEY_EVENT,
-    };
-    UInt8Set previousIDs;
-    UInt8Set &currentIDs = data.ids;
+    // 押されているIDのビット
+    uint64_t pressedIDs = 0;
 
     while (1) {
-        if (needsKeyScan()) {
-            // スキャン
-            outputsWrite(HIGH);
-            for (int o = 0; o < OUTPUTS_SIZE; o++) {
-                digitalWrite(outputs[o], LOW);
-                for (int i = 0; i < INPUTS_SIZE; i++) {
-                    if (switches[o][i] == nullptr) {
-                        continue;
-                    }
-                    switches[o][i]->update(currentIDs);
-                }
-                digitalWrite(outputs[o], HIGH);
-            }
-            // 割り込みのために出力をLOWに設定
-            outputsWrite(LOW);
-            // 更新してたらloopに送る。
-            if (currentIDs != previousIDs) {
-                xQueueSend(eventQueue, &data, portMAX_DELAY);
-                previousIDs = currentIDs;
+        // スキャン、1行につきポートの読み込みは1回だけ
+        uint64_t raw = scanMatrix();
+        // 状態の変化はこのスキャンの時刻で記録する
+        Timestamp scanTime = currentTimestamp();
+
+        // 次のスキャンの速さを決める、確定前の変化があれば一番速くしてからチャタリング除去する
+        governor.setBasePeriod(requestedScanPeriod);
+        governor.update(raw != debouncer.state() || debouncer.isSettled() == false, (raw | debouncer.state()) != 0);
+        if (governor.isIdle() == false && governor.period() != scanTimer.period()) {
+            scanTimer.stop();
+            applyScanPeriod(governor.period());
+        }
+
+        uint64_t changed = debouncer.update(raw);
+        // 状態が変わったスイッチがあればIDのビットにしてloopに最新の状態を渡す
+        if (changed != 0) {
+            while (changed != 0) {
+                int n = __builtin_ctzll(changed);
+                changed &= changed - 1;
+                pressedIDs ^= keyIDBit(bitToKeyID[n]);
             }
-            // poll interval
-            delay(DEBOUNCE_DELAY / 2);
+            publishKeyState(scanStateMailbox, pressedIDs, scanTime);
+        }
+
+        if (governor.isIdle() == false) {
+            // 次のスキャンの時間まで寝る、止まっていたらタイマーを開始して1周期後にスキャンする
+            scanTimer.start();
+            xQueueReceive(scanTickQueue, &tmp, portMAX_DELAY);
         } else {
-            // 起きてた時に来た通知はクリアーする
+            scanTimer.stop();
+            xQueueReset(scanTickQueue);
+            // 起きてた時に来た通知はクリアーしてから割り込みを有効にする
+            // 有効にした時点でもう押されていたらすぐにスキャンし直す
             xQueueReset(keyInterruptQueue);
-            // needsKeyScan内での割り込みチェック後から再度割り込みが発生してなければ
-            if (isInterrupted == false) {
-                // 割り込みが発生するまで寝る
+            if (portSense.arm()) {
+                // 割り込みが発生するまで寝る、割り込みは1回発生すると無効になる
+                governor.sleep(millis());
                 xQueueReceive(keyInterruptQueue, &tmp, portMAX_DELAY);
+                governor.wakeup(millis());
             }
         }
     }
 }
 
+void setScanPeriod(uint32_t us) {
+    if (us != 0) {
+        requestedScanPeriod = us;
+    }
+}
+
+uint32_t getScanPeriod() {
+    return requestedScanPeriod;
+}
+
+void getScanRateStats(ScanRateStats &stats) {
+    taskENTER_CRITICAL();
+    stats = governor.stats();
+    taskEXIT_CRITICAL();
+}
+
+uint32_t getSuppressedInterruptCount() {
+    return portSense.maskedEventCount();
+}
+
 void startKeyScan(UBaseType_t priority) {
     initMatrix();
     xTaskCreate(keyScanTask, "keyScan", 128, NULL, priority, NULL);
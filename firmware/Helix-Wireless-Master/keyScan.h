@@ -24,6 +24,18 @@
 
 #pragma once
 
+#include "ScanGovernor.h"
 #include <Arduino.h>
 
 void startKeyScan(UBaseType_t priority);
+
+// キースキャン中のスキャン周期(us)の変更と取得、変更は次のスキャンから反映される
+void setScanPeriod(uint32_t us);
+
+uint32_t getScanPeriod();
+
+// スキャン速度の段階ごとの滞在時間を取得
+void getScanRateStats(ScanRateStats &stats);
+
+// スキャン中に割り込みを無効にしていたことで発生しなかった割り込みの回数
+uint32_t getSuppressedInterruptCount();
@@ -24,6 +24,7 @@
 
 #include "keymap.h"
 #include "Command.h"
+#include "UInt8Set.h"
 #include "config.h"
 #include "keycode.h"
 
@@ -194,6 +195,11 @@ struct SequenceKey {
    * `-------------------------------------------------------------------------------------------------'
    */
 
+// ホストのベンチマーク(Helix-Wireless-HostSim)ではキーマップの定義を差し替えられるようにしてある
+#ifdef KEYMAP_OVERRIDE
+#include KEYMAP_OVERRIDE
+#else
+
 static const int LOWER = 1;
 static const int RAISE = 2;
 
@@ -276,6 +282,8 @@ static SequenceKey sequenceKeymap[] = {
 
 };
 
+#endif
+
 /*------------------------------------------------------------------*/
 /*  define function
  *------------------------------------------------------------------*/
@@ -318,27 +326,49 @@ static uint matchSequence(const uint8_t ids[], uint len, SequenceKey **matched)
     return 0;
 }
 
-void applyToKeymap(const UInt8Set &ids) {
-    static UInt8Set prevIDs, pressedInMatchModeIDs;
+// 同時押しキーマップの定義にIDが含まれているか
+static bool containsID(const uint8_t ids[], uint len, uint8_t id) {
+    for (int i = 0; i < len; i++) {
+        if (ids[i] == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void applyToKeymap(uint8_t id, bool pressed, Timestamp time) {
+    static UInt8Set ids, pressedInMatchModeIDs;
     static uint8_t seq[MAX_SEQUENCE_COUNT];
     static uint seqLen = 0;
     static SequenceKey *matched;
 
+    // 押されているIDの集合を変化分だけ更新する、変化が無ければ何もしない
+    if (ids.contains(id) == pressed) {
+        return;
+    }
+    if (pressed) {
+        ids.add(id);
+    } else {
+        ids.remove(id);
+    }
+
+    Command::setEventTime(time);
+
     // SEQ_MODE_MATCH内で押されたIDのリリースを監視する
-    if (pressedInMatchModeIDs.count() != 0) {
-        // １つ前のIDs - 現在のIDs = リリースされたIDs
-        UInt8Set releaseIDs = prevIDs - ids;
-        pressedInMatchModeIDs -= releaseIDs;
+    if (pressed == false) {
+        pressedInMatchModeIDs.remove(id);
     }
 
     // apply to normal keymap
+    // 状態が変わるのは変化したIDのコマンドだけ
     for (int i = 0; i < arrcount(keymap); i++) {
+        if (keymap[i].id != id) {
+            continue;
+        }
         // SEQ_MODE_MATCH内で押されたIDなら何もしない
-        if (pressedInMatchModeIDs.contains(keymap[i].id)) {
+        if (pressedInMatchModeIDs.contains(id)) {
             continue;
         }
-        // IDが押されているかを取得
-        bool pressed = ids.contains(keymap[i].id);
         // SEQ_MODE_MATCHの時はリリースのみ許可する
         if ((pressed == true) && (sequenceModeState == SEQ_MODE_MATCH)) {
             continue;
@@ -349,18 +379,22 @@ void applyToKeymap(const UInt8Set &ids) {
 
     // apply to simultaneous keymap
     for (int i = 0; i < arrcount(simultaneousKeymap); i++) {
+        // 変化したIDを含む定義だけ
+        if (containsID(simultaneousKeymap[i].ids, simultaneousKeymap[i].idsLength, id) == false) {
+            continue;
+        }
         // SEQ_MODE_MATCH内で押されたIDが含まれていたら何もしない
         if (pressedInMatchModeIDs.containsAny(simultaneousKeymap[i].ids, simultaneousKeymap[i].idsLength)) {
             continue;
         }
         // 全てのIDが押されているかを取得
-        bool pressed = ids.containsAll(simultaneousKeymap[i].ids, simultaneousKeymap[i].idsLength);
+        bool allPressed = ids.containsAll(simultaneousKeymap[i].ids, simultaneousKeymap[i].idsLength);
         // SEQ_MODE_MATCHの時はリリースのみ許可する
-        if ((pressed == true) && (sequenceModeState == SEQ_MODE_MATCH)) {
+        if ((allPressed == true) && (sequenceModeState == SEQ_MODE_MATCH)) {
             continue;
         }
         // コマンドに現在の状態を適用する
-        simultaneousKeymap[i].command->apply(pressed);
+        simultaneousKeymap[i].command->apply(allPressed);
     }
 
     // apply to sequence keymap
@@ -368,16 +402,9 @@ void applyToKeymap(const UInt8Set &ids) {
         // マッチングをするのは次の入力から
         sequenceModeState = SEQ_MODE_MATCH;
     } else if (sequenceModeState == SEQ_MODE_MATCH) {
-        // 現在のIDs - １つ前のIDs = 新しく押されたIDs
-        UInt8Set newPressIDs = ids - prevIDs;
-
-        uint len = newPressIDs.count();
-        uint8_t buf[len];
-        newPressIDs.toArray(buf);
         // SEQ_MODE_MATCHに移行してから押された全てのIDを入れておく
-        int i = 0;
-        while ((seqLen < MAX_SEQUENCE_COUNT) && (i < len)) {
-            seq[seqLen++] = buf[i++];
+        if ((pressed == true) && (seqLen < MAX_SEQUENCE_COUNT)) {
+            seq[seqLen++] = id;
         }
         // SEQ_MODE_MATCHに移行してから押された全てのIDとsequenceKeymapを比較してIDの順番がマッチする定義があるか調べる
         int matchResult = matchSequence(seq, seqLen, &matched);
@@ -393,7 +420,9 @@ void applyToKeymap(const UInt8Set &ids) {
         }
         // SEQ_MODE_MATCH内で押されたIDは１回リリースされるまではコマンドを実行しない
         // そのためリリースを監視する必要があるので追加していく
-        pressedInMatchModeIDs |= newPressIDs;
+        if (pressed == true) {
+            pressedInMatchModeIDs.add(id);
+        }
 
     } else if (sequenceModeState == SEQ_MODE_KEY_RELEASE) {
         // SEQ_MODE_MATCHで実行したコマンドを解除するためにキーアップを監視する
@@ -403,5 +432,21 @@ void applyToKeymap(const UInt8Set &ids) {
             sequenceModeState = SEQ_MODE_DISABLE;
         }
     }
-    prevIDs = ids;
+}
+
+// bitsのIDを全部pressedにする
+static void applyKeyBits(uint64_t bits, bool pressed, Timestamp time) {
+    while (bits != 0) {
+        applyToKeymap(__builtin_ctzll(bits) + 1, pressed, time);
+        bits &= bits - 1;
+    }
+}
+
+void applyKeyState(const KeyState &state) {
+    // 前回読んだ後に押して離された(離して押された)IDは途中の状態を先に適用する
+    applyKeyBits(state.bounced & ~state.pressed, true, state.firstChangeTime);
+    applyKeyBits(state.bounced & state.pressed, false, state.firstChangeTime);
+    // 離された物を先に適用する
+    applyKeyBits(state.changed & ~state.pressed, false, state.time);
+    applyKeyBits(state.changed & state.pressed, true, state.time);
 }
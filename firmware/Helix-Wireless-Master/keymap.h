@@ -24,9 +24,14 @@
 
 #pragma once
 
-#include "UInt8Set.h"
+#include "KeyStateMailbox.h"
+#include "Timestamp.h"
 #include <bluefruit.h>
 
 void initKeymap(BLEHidAdafruit &blehid);
 
-void applyToKeymap(const UInt8Set &ids);
+// IDの押下状態の変化を1つ適用する、timeはその変化が起きた時刻
+void applyToKeymap(uint8_t id, bool pressed, Timestamp time);
+
+// メールボックスから読み出した状態の変化をIDごとに適用する
+void applyKeyState(const KeyState &state);
@@ -23,9 +23,119 @@
 */
 
 #include "queues.h"
+#include "Timer.h"
+#include "config.h"
 
-QueueHandle_t eventQueue;
+KeyStateMailbox scanStateMailbox;
+KeyStateMailbox bleStateMailbox;
+
+static KeyStateMailbox *const mailboxes[] = {&scanStateMailbox, &bleStateMailbox};
+
+const static int MAILBOX_COUNT = sizeof(mailboxes) / sizeof(mailboxes[0]);
+
+// 変化してから返すまで待たせる時間、スレーブ側の変化は無線の分だけ遅れて届くのでマスター側の方を待たせる
+const static uint32_t holdTimes[MAILBOX_COUNT] = {msToTimestamp(SPLIT_REORDER_WINDOW), 0};
+
+// 読み出したがまだ返していない状態、別のメールボックスの方が早く変化していたら後で返す
+static KeyState pendingStates[MAILBOX_COUNT];
+static bool hasPendingState[MAILBOX_COUNT];
+
+static TaskHandle_t loopTaskHandle;
 
 void initQueues() {
-    eventQueue = xQueueCreate(64, sizeof(EventData));
+    loopTaskHandle = xTaskGetCurrentTaskHandle();
+}
+
+void publishKeyState(KeyStateMailbox &mailbox, uint64_t pressed, Timestamp time) {
+    mailbox.publish(pressed, time);
+    xTaskNotifyGive(loopTaskHandle);
+}
+
+// 更新されたメールボックスを読み出して一番早く変化した物を返す、無ければ-1
+static int readEarliest() {
+    int earliest = -1;
+    for (int i = 0; i < MAILBOX_COUNT; i++) {
+        if (hasPendingState[i] == false) {
+            hasPendingState[i] = mailboxes[i]->read(pendingStates[i]);
+        }
+        if (hasPendingState[i] == false) {
+            continue;
+        }
+        if (earliest == -1 || (int32_t)(pendingStates[i].firstChangeTime - pendingStates[earliest].firstChangeTime) < 0) {
+            earliest = i;
+        }
+    }
+    return earliest;
+}
+
+bool receiveKeyState(KeyState &state, TickType_t ticksToWait) {
+    TickType_t start = xTaskGetTickCount();
+    while (1) {
+        int earliest = readEarliest();
+        // 一番早い物を待たせている間は、後から変化した物も順番が変わらないように待たせる
+        TickType_t holdTicks = 0;
+        if (earliest != -1) {
+            holdTicks = Timer::ticksUntil(pendingStates[earliest].firstChangeTime + holdTimes[earliest]);
+            if (holdTicks == 0) {
+                state = pendingStates[earliest];
+                hasPendingState[earliest] = false;
+                return true;
+            }
+        }
+        // 更新が無ければ通知が来るまで寝る、確認した後に書き込まれた物は通知が残っているのですぐ起きる
+        // 読み出し済みの物の通知が残っていて更新が無いまま起きることもあるので、待つ時間は最初からの経過で決める
+        TickType_t wait = portMAX_DELAY;
+        if (ticksToWait != portMAX_DELAY) {
+            TickType_t elapsed = xTaskGetTickCount() - start;
+            if (elapsed >= ticksToWait) {
+                return false;
+            }
+            wait = ticksToWait - elapsed;
+        }
+        if (holdTicks != 0 && holdTicks < wait) {
+            wait = holdTicks;
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+bool nextHeldKeyState(Timestamp &time) {
+    int earliest = readEarliest();
+    if (earliest == -1) {
+        return false;
+    }
+    time = pendingStates[earliest].firstChangeTime + holdTimes[earliest];
+    return true;
+}
+
+Timestamp timerFiringLimit(Timestamp time) {
+    int earliest = readEarliest();
+    if (earliest != -1 && (int32_t)(pendingStates[earliest].firstChangeTime - time) < 0) {
+        return pendingStates[earliest].firstChangeTime;
+    }
+    return time;
+}
+
+bool nextTimerDeadline(Timestamp &deadline) {
+    if (Timer::nextDeadline(deadline) == false) {
+        return false;
+    }
+    // 変化の方が先ならreceiveKeyStateがその変化を返してから発火させる
+    int earliest = readEarliest();
+    return earliest == -1 || (int32_t)(deadline - pendingStates[earliest].firstChangeTime) <= 0;
+}
+
+TickType_t ticksUntilNextTimer() {
+    Timestamp deadline;
+    if (nextTimerDeadline(deadline) == false) {
+        return portMAX_DELAY;
+    }
+    return Timer::ticksUntil(deadline);
+}
+
+MailboxStats mailboxStats() {
+    MailboxStats stats;
+    stats.scanMerges = scanStateMailbox.mergeCount();
+    stats.bleMerges = bleStateMailbox.mergeCount();
+    return stats;
 }
@@ -24,25 +24,43 @@
 
 #pragma once
 
-#include "Timer.h"
-#include "Uint8Set.h"
+#include "KeyStateMailbox.h"
 #include <Arduino.h>
 
-// loopTaskとやり取りするキューとデータの定義
-extern QueueHandle_t eventQueue;
+// loopTaskとやり取りする状態の定義
+// 送る側(タスク)ごとに1つずつメールボックスを持ち、最新の状態を書き込んだらタスク通知でloopTaskを起こす
+// loopTaskは更新されたメールボックスを変化の時刻順に読み出す
+// 送る側ごとの最新の状態
+extern KeyStateMailbox scanStateMailbox; // keyScanTask
+extern KeyStateMailbox bleStateMailbox;  // BLEのコールバック (スレーブ側のID)
 
-enum EventType {
-    SCAN_KEY_EVENT,
-    BLE_KEY_EVENT,
-    TIMER_EVENT,
-};
+// loopTaskから呼ぶ
+void initQueues();
+
+// mailboxに書き込んでloopTaskを起こす、待つことは無いのでBLEのコールバックからも呼べる
+void publishKeyState(KeyStateMailbox &mailbox, uint64_t pressed, Timestamp time);
+
+// 更新されたメールボックスのうち一番早く変化した物を読み出す、どれも更新されていなければticksToWaitまで待つ
+// scanStateMailboxの変化は、スレーブ側のそれより前の変化が届くのをSPLIT_REORDER_WINDOWまで待ってから返す
+bool receiveKeyState(KeyState &state, TickType_t ticksToWait);
+
+// 待たせている変化があればtrue、timeに返せるようになる時刻を入れる
+bool nextHeldKeyState(Timestamp &time);
 
-struct EventData {
-    enum EventType eventType;
-    union {
-        UInt8Set ids; // SCAN_KEY_EVENT, BLE_KEY_EVENT
-        Timer *timer; // TIMER_EVENT
-    };
+// loopTaskから、timeまでに期限が来たタイマーを発火させる時の上限
+// まだ返していない変化より後が期限のタイマーは、順番が入れ替わらないようにその変化を返すまで発火させない
+Timestamp timerFiringLimit(Timestamp time);
+
+// 次に発火させるタイマーの期限、まだ返していない変化より後の物はその変化が先なので無ければfalse
+bool nextTimerDeadline(Timestamp &deadline);
+
+// loopTaskから、receiveKeyStateで次のタイマーの期限まで待つ時のtick数
+TickType_t ticksUntilNextTimer();
+
+// メールボックスごとの、loopTaskが読む前に次の書き込みでまとめられた回数
+struct MailboxStats {
+    uint32_t scanMerges; // scanStateMailbox
+    uint32_t bleMerges;  // bleStateMailbox
 };
 
-void initQueues();
+MailboxStats mailboxStats();
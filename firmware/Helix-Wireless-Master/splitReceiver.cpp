@@ -0,0 +1,229 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "splitReceiver.h"
+#include "Timer.h"
+#include "config.h"
+#include "queues.h"
+
+static SplitLink *splitLink;
+
+// スレーブ側から受け取ったフレームを押されているIDに戻す
+static SplitFrameDecoder splitDecoder;
+// スレーブ側の時刻をマスター側の時刻に直す、受け取りのコールバックの中だけで使う
+static ClockSync clockSync;
+// 最後にloopに渡したスレーブ側のIDと時刻、定期的なスナップショットで変化が無ければ渡さない
+// BLEのタスクとloopTask(SplitWatchdog)の両方から書き込むので、bleStateMailboxへの書き込みと一緒にクリティカルセクションの中で変える
+static uint64_t publishedBleIDs = 0;
+static Timestamp publishedBleTime = 0;
+// 最後に壊れていないフレームを受け取った時刻
+static Timestamp lastFrameTime = 0;
+// SplitWatchdogが全部離してから、まだスナップショットで押されているIDを受け取り直していない
+static bool isStalled = false;
+static SplitWatchdogStats watchdogStats = {};
+
+// スレーブ側に押されているIDを全部送ってもらう
+static void sendResyncRequest() {
+    uint8_t buf[SPLIT_FRAME_MAX_SIZE];
+    size_t size = SplitFrameEncoder::encodeResyncRequest(buf);
+    splitLink->send(buf, size);
+}
+
+// 一定間隔でスレーブ側と時計を合わせる、返事はreceive_callbackで受け取る
+class TimeSyncTimer : public Timer {
+  public:
+    TimeSyncTimer() : Timer(TIME_SYNC_INTERVAL, true) {
+    }
+
+    void start() {
+        startTimer();
+    }
+
+    void onTimer() override {
+        // 繋がっていなければ送られないだけ
+        uint8_t buf[SPLIT_FRAME_MAX_SIZE];
+        size_t size = SplitFrameEncoder::encodeTimeRequest(currentTimestamp(), buf);
+        splitLink->send(buf, size);
+    }
+};
+
+static TimeSyncTimer timeSyncTimer;
+
+// スレーブ側のIDを全部離す、クリティカルセクションの中で呼ぶ
+static void releaseBleIDs(Timestamp time) {
+    publishedBleIDs = 0;
+    publishedBleTime = time;
+    publishKeyState(bleStateMailbox, 0, time);
+}
+
+// スレーブ側のキーが押されている間にフレームが届かなくなったら全部離す
+// 切断はスーパービジョンタイムアウト(数秒)まで分からないので、その間キーが押しっぱなしにならないようにする
+// 何も押されていない時はSPLIT_WATCHDOG_TIMEOUTごと、押されている間はその1/4ごとに確かめる
+class SplitWatchdog : public Timer {
+  public:
+    SplitWatchdog() : Timer(SPLIT_WATCHDOG_TIMEOUT, true) {
+    }
+
+    void start() {
+        startTimer();
+    }
+
+    void onTimer() override {
+        Timestamp now = currentTimestamp();
+        bool isReleased = false;
+        taskENTER_CRITICAL();
+        bool isHeld = (publishedBleIDs != 0);
+        if (isHeld && now - lastFrameTime >= msToTimestamp(SPLIT_WATCHDOG_TIMEOUT)) {
+            watchdogStats.releases++;
+            watchdogStats.releasedKeys += __builtin_popcountll(publishedBleIDs);
+            releaseBleIDs(now);
+            isStalled = true;
+            isHeld = false;
+            isReleased = true;
+        }
+        taskEXIT_CRITICAL();
+        // 繋がっていればスナップショットを送ってもらう、届かなければ次に受け取った時にもう一度要求する
+        if (isReleased) {
+            sendResyncRequest();
+        }
+        if (isHeld != _isWatching) {
+            _isWatching = isHeld;
+            changePeriod(isHeld ? SPLIT_WATCHDOG_TIMEOUT / 4 : SPLIT_WATCHDOG_TIMEOUT);
+        }
+    }
+
+  private:
+    bool _isWatching = false;
+};
+
+static SplitWatchdog splitWatchdog;
+
+static void connection_callback(bool isConnected) {
+    splitDecoder.reset();
+    taskENTER_CRITICAL();
+    isStalled = false;
+    if (isConnected) {
+        lastFrameTime = currentTimestamp();
+    } else {
+        // 切断されたらキーが押しっぱなしにならないように全部離す
+        releaseBleIDs(currentTimestamp());
+    }
+    taskEXIT_CRITICAL();
+    if (isConnected) {
+        clockSync.reset();
+        sendResyncRequest();
+    }
+}
+
+// スレーブ側で変化した時刻をマスター側の時刻に直す
+// まだ時計を合わせていなければ受け取った時刻にする、どちらにしても受け取った時刻より後や前回より前にはしない
+static Timestamp bleEventTime(Timestamp remote, Timestamp received) {
+    if (clockSync.isSynced() == false) {
+        return received;
+    }
+    Timestamp time = clockSync.toLocal(remote);
+    if ((int32_t)(time - received) > 0) {
+        time = received;
+    }
+    if ((int32_t)(time - publishedBleTime) < 0) {
+        time = publishedBleTime;
+    }
+    return time;
+}
+
+// スレーブ側でremoteにpressedになったのをloopに渡す、クリティカルセクションの中で呼ぶ
+static void publishBleIDs(uint64_t pressed, Timestamp remote, Timestamp received) {
+    if (pressed != publishedBleIDs) {
+        publishedBleIDs = pressed;
+        publishedBleTime = bleEventTime(remote, received);
+        publishKeyState(bleStateMailbox, publishedBleIDs, publishedBleTime);
+    }
+}
+
+static void receive_callback(const uint8_t *frame, size_t size) {
+    Timestamp received = currentTimestamp();
+    // 1回の受け取りにフレーム1つなので受け取ったバッファのまま読む
+    bool isDecoded = splitDecoder.decode(frame, size);
+    bool needsResync = splitDecoder.takeResyncRequest();
+    taskENTER_CRITICAL();
+    // 壊れたフレームしか届かない間はスレーブ側の状態が分からないので、見張りには数えない
+    if (isDecoded) {
+        if (publishedBleIDs != 0 && received - lastFrameTime > watchdogStats.longestSilence) {
+            watchdogStats.longestSilence = received - lastFrameTime;
+        }
+        lastFrameTime = received;
+    }
+    if (isStalled) {
+        // 止まっていた間の変化は分からないので、スナップショットを受け取るまではloopに渡さない
+        if (isDecoded && splitDecoder.frameType() == SNAPSHOT_FRAME) {
+            isStalled = false;
+            watchdogStats.recoveries++;
+        } else {
+            needsResync = true;
+        }
+    }
+    if (isDecoded && isStalled == false) {
+        // 最新の状態を書き込むだけなのでloopが遅れていてもBLEのタスクは待たされない
+        // DELTA_FRAMEは変化した順にそれぞれの時刻で書き込んで、最初に変化した時刻と途中で押して離したキーを残す
+        if (splitDecoder.frameType() == DELTA_FRAME) {
+            for (size_t i = 0; i < splitDecoder.changeCount(); i++) {
+                publishBleIDs(splitDecoder.changedPressed(i), splitDecoder.changeTime(i), received);
+            }
+        } else if (splitDecoder.frameType() != TIME_RESPONSE_FRAME) {
+            publishBleIDs(splitDecoder.pressed(), splitDecoder.time(), received);
+        }
+    }
+    taskEXIT_CRITICAL();
+    if (isDecoded && splitDecoder.frameType() == TIME_RESPONSE_FRAME) {
+        clockSync.addSample(splitDecoder.timeSyncSample(), received);
+    }
+    // 抜けがあったら全部送ってもらう
+    if (needsResync) {
+        sendResyncRequest();
+    }
+}
+
+void startSplitReceiver(SplitLink &link) {
+    splitLink = &link;
+    link.setReceiveCallback(receive_callback);
+    link.setConnectionCallback(connection_callback);
+    timeSyncTimer.start();
+    splitWatchdog.start();
+}
+
+uint64_t receivedSlaveIDs() {
+    return publishedBleIDs;
+}
+
+const SplitLinkStats &splitLinkStats() {
+    return splitDecoder.stats();
+}
+
+const SplitWatchdogStats &splitWatchdogStats() {
+    return watchdogStats;
+}
+
+ClockSyncStats clockSyncStats() {
+    return clockSync.stats();
+}
@@ -0,0 +1,48 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "ClockSync.h"
+#include "SplitLink.h"
+#include "SplitProtocol.h"
+
+// スレーブ側のキーが押されている間にフレームが届かなくなって、切断を待たずに全部離した時の統計
+struct SplitWatchdogStats {
+    uint32_t releases;        // 全部離した回数
+    uint32_t releasedKeys;    // その時に押されていたキーの数の合計
+    uint32_t recoveries;      // 離した後でスナップショットを受け取り直した回数
+    Timestamp longestSilence; // キーが押されている間にフレームが届かなかった一番長い時間
+};
+
+// スレーブ側から受け取ったフレームを押されているIDに戻してbleStateMailboxに書き込む
+// linkの受け取りと接続のコールバックを設定して、時刻合わせと見張りのタイマーを開始する、loopTaskから1回だけ呼ぶ
+void startSplitReceiver(SplitLink &link);
+
+// 最後にbleStateMailboxに書き込んだスレーブ側のID
+uint64_t receivedSlaveIDs();
+
+const SplitLinkStats &splitLinkStats();
+const SplitWatchdogStats &splitWatchdogStats();
+ClockSyncStats clockSyncStats();
@@ -0,0 +1,107 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "Debouncer.h"
+
+// 入力がdelayの間変化しなかったら確定 => 最初の変化も含めてdelay / scanPeriod + 1回連続
+static uint8_t delayToSamples(uint8_t delay, uint32_t scanPeriod) {
+    uint32_t samples = delay * 1000UL / scanPeriod + 1;
+    return min(samples, Debouncer::MAX_SAMPLES);
+}
+
+// 確定後lockoutの間無視 => 切り上げでlockout / scanPeriod回
+static uint8_t lockoutToSamples(uint8_t lockout, uint32_t scanPeriod) {
+    uint32_t samples = (lockout * 1000UL + scanPeriod - 1) / scanPeriod;
+    return min(samples, Debouncer::MAX_SAMPLES);
+}
+
+static void writePlanes(uint64_t (&planes)[Debouncer::COUNTER_BITS], uint8_t n, uint8_t value) {
+    for (int b = 0; b < Debouncer::COUNTER_BITS; b++) {
+        if (bitRead(value, b)) {
+            planes[b] |= (1ULL << n);
+        } else {
+            planes[b] &= ~(1ULL << n);
+        }
+    }
+}
+
+void Debouncer::setPolicy(uint8_t n, const DebouncePolicy &policy, uint32_t scanPeriod) {
+    if (n >= 64 || scanPeriod == 0) {
+        return;
+    }
+    writePlanes(_pressSamples, n, delayToSamples(policy.pressDelay, scanPeriod));
+    writePlanes(_releaseSamples, n, delayToSamples(policy.releaseDelay, scanPeriod));
+    writePlanes(_lockoutSamples, n, lockoutToSamples(policy.lockout, scanPeriod));
+}
+
+uint64_t Debouncer::update(uint64_t raw) {
+    // 入力を無視している間のスイッチは残り回数を1減らす
+    uint64_t locked = 0;
+    for (int b = 0; b < COUNTER_BITS; b++) {
+        locked |= _lock[b];
+    }
+    uint64_t borrow = locked;
+    for (int b = 0; b < COUNTER_BITS; b++) {
+        uint64_t next = _lock[b] ^ borrow;
+        borrow &= ~_lock[b];
+        _lock[b] = next;
+    }
+
+    // 確定している状態と違う値を読んだスイッチだけカウントを進め、それ以外は0に戻す
+    uint64_t delta = (raw ^ _state) & ~locked;
+    uint64_t carry = delta;
+    for (int b = 0; b < COUNTER_BITS; b++) {
+        uint64_t next = (_count[b] ^ carry) & delta;
+        carry &= _count[b];
+        _count[b] = next;
+    }
+
+    // カウンターがしきい値(押した時と離した時で別)に達したスイッチの状態を反転する
+    uint64_t notEqual = 0;
+    for (int b = 0; b < COUNTER_BITS; b++) {
+        uint64_t samples = (_pressSamples[b] & raw) | (_releaseSamples[b] & ~raw);
+        notEqual |= _count[b] ^ samples;
+    }
+    uint64_t changed = delta & ~notEqual;
+    _state ^= changed;
+
+    // 反転したスイッチはカウンターを0に戻して、しばらく入力を無視する
+    for (int b = 0; b < COUNTER_BITS; b++) {
+        _count[b] &= ~changed;
+        _lock[b] |= _lockoutSamples[b] & changed;
+    }
+    return changed;
+}
+
+uint64_t Debouncer::state() const {
+    return _state;
+}
+
+bool Debouncer::isSettled() const {
+    uint64_t busy = 0;
+    for (int b = 0; b < COUNTER_BITS; b++) {
+        busy |= _count[b] | _lock[b];
+    }
+    return busy == 0;
+}
@@ -16,10 +16,14 @@
 #include "blinkLED.h"
 #include "config.h"
 #include "keyScan.h"
+#include "Timer.h"
+#include "RadioNotification.h"
+#include "SplitService.h"
+#include "splitSender.h"
 #include "queues.h"
 #include <bluefruit.h>
 
-static BLEUart bleuart;
+static SplitService splitService;
 static BLEBas blebas;
 
 static inline void blinkAdvLED() { blinkLED2(); }
@@ -37,10 +41,11 @@ void setup() {
     Bluefruit.autoConnLed(false);
     Bluefruit.setConnectCallback(connect_callback);
     Bluefruit.setDisconnectCallback(disconnect_callback);
-    Bluefruit.setConnIntervalMS(10, 20);
+    Bluefruit.setEventCallback(ble_event_callback);
+    Bluefruit.setConnInterval(SPLIT_LINK_INTERVAL_MIN, SPLIT_LINK_INTERVAL_MAX);
 
-    // Configure and Start BLE Uart Service
-    bleuart.begin();
+    // マスター側と押されているIDをやり取りするサービス
+    splitService.begin();
 
     // Start BLE Battery Service
     blebas.begin();
@@ -52,6 +57,8 @@ void setup() {
     UBaseType_t priority = uxTaskPriorityGet(NULL);
     initLED(priority);
     startKeyScan(priority);
+    startSplitSender(splitService);
+    radioNotification.init(radio_notification_callback);
 
     // Set up and start advertising
     startAdv();
@@ -62,8 +69,8 @@ static void startAdv(void) {
     Bluefruit.Advertising.addFlags(BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE);
     Bluefruit.Advertising.addTxPower();
 
-    // Include bleuart 128-bit uuid
-    Bluefruit.Advertising.addService(bleuart);
+    // マスター側はこのサービスのUUIDでスキャンする
+    Bluefruit.Advertising.addService(splitService);
 
     // Secondary Scan Response packet (optional)
     // Since there is no room for 'Name' in Advertising packet
@@ -87,28 +94,65 @@ static void startAdv(void) {
 
 static void connect_callback(uint16_t conn_handle) {
     turnOffAdvLED();
+    splitService.setConnected(true);
 }
 
 static void disconnect_callback(uint16_t conn_handle, uint8_t reason) {
     blinkAdvLED();
+    setConnectionInterval(0);
+    splitService.setConnected(false);
+}
+
+// 接続の実際のパラメーターを知らせる
+static void updateConnection(const ble_gap_conn_params_t &params) {
+    // スレーブレイテンシがある間は接続イベントを飛ばすので、次の接続イベントを予想しない
+    setConnectionInterval(params.slave_latency != 0 ? 0 : params.max_conn_interval);
+}
+
+static void ble_event_callback(ble_evt_t *event) {
+    const ble_gap_evt_t &gap = event->evt.gap_evt;
+    if (event->header.evt_id == BLE_GAP_EVT_CONNECTED) {
+        updateConnection(gap.params.connected.conn_params);
+    } else if (event->header.evt_id == BLE_GAP_EVT_CONN_PARAM_UPDATE) {
+        updateConnection(gap.params.conn_param_update.conn_params);
+    }
+}
+
+// 無線が動き出す前の割り込み
+static void radio_notification_callback(BaseType_t *woken) {
+    Timestamp time;
+    if (radioNotification.lastNotification(time)) {
+        connectionEventNotified(time, woken);
+    }
+}
+
+// デバッグ用、メールボックスと送り方の統計をシリアルに書き出す
+void dbgSenderStats() {
+    MailboxStats mailbox = mailboxStats();
+    const TxCoalescingStats &tx = txCoalescingStats();
+    Serial.printf("mailbox: scanMerges=%lu\n", (unsigned long)mailbox.scanMerges);
+    Serial.printf("tx: frames=%lu savedWrites=%lu fallbacks=%lu\n",
+                  (unsigned long)tx.frames, (unsigned long)tx.savedWrites, (unsigned long)tx.fallbacks);
+}
+
+// timeまでに期限が来たタイマーを期限順に発火させる
+static void fireTimers(Timestamp time) {
+    Timer *timer;
+    while ((timer = Timer::nextExpired(time)) != nullptr) {
+        timer->fire();
+    }
 }
 
 void loop() {
-    EventData data = {};
-    xQueueReceive(eventQueue, &data, portMAX_DELAY);
-
-    if (data.eventType == SCAN_KEY_EVENT) {
-        // 配列にする、終端0を追加するため1バイト大きいサイズで領域確保
-        uint size = data.ids.count() + 1;
-        uint8_t buf[size];
-        data.ids.toArray(buf);
-        // 終端0を追加
-        buf[size - 1] = 0;
-        // 送る
-        bleuart.write(buf, size);
-    } else if (data.eventType == TIMER_EVENT) {
-        data.timer->onTimer();
+    KeyState state;
+    // 次のタイマーの期限までキーの状態の変化を待つ
+    if (receiveKeyState(state, Timer::ticksUntilNextDeadline())) {
+        fireTimers(state.firstChangeTime);
+        sendKeyState(state);
     }
+    processSplitRequests();
+    fireTimers(currentTimestamp());
 
     //dbgMemInfo();
+    //dbgSenderStats();
 }
@@ -0,0 +1,88 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "Timestamp.h"
+#include <Arduino.h>
+
+// キーIDのビット位置、IDは1から64なのでuint64_tのbit(id - 1)で表す
+constexpr uint64_t keyIDBit(uint8_t id) {
+    return 1ULL << (id - 1);
+}
+
+// 読み出し側から見た前回読んだ時からの変化
+struct KeyState {
+    uint64_t pressed;          // 今押されているID
+    uint64_t changed;          // 前回読んだ時から変化したID
+    uint64_t bounced;          // changedの内、前回読んだ時と同じ状態に戻ったID (押して離した、離して押した)
+    Timestamp firstChangeTime; // 前回読んだ後で最初に変化した時刻
+    Timestamp time;            // 最後に変化した時刻
+};
+
+// 押されているIDの最新の状態を1つのタスクから別の1つのタスクに渡す
+// キーの状態は流れではなく水準なので、キューで1個ずつコピーせずに最新の状態と読まれていない間の変化だけを渡す
+// 書き込み側はバッファを2つ交互に使い、それぞれのバッファのシーケンス番号で読み出し中の書き換えを検出する (seqlock)
+// 読まれる前に何回書き込まれてもRAMは一定で、書き込み側が待たされることは無い
+class KeyStateMailbox {
+  public:
+    // 書き込み側、状態が変わった時に呼ぶ
+    void publish(uint64_t pressed, Timestamp time);
+
+    // 読み出し側、前回読んだ時から書き込まれていればtrue
+    bool read(KeyState &state);
+
+    // 読み出し側、まだ読んでいない書き込みがあるか
+    bool hasUpdate() const;
+
+    // 読まれる前に次の書き込みでまとめられた回数
+    uint32_t mergeCount() const {
+        return _mergeCount;
+    }
+
+  private:
+    struct Block {
+        volatile uint32_t version; // 書き込み中は奇数
+        uint32_t seq;              // 何回目の書き込みか
+        uint32_t baseSeq;          // changedがどの書き込みの後からの変化か
+        uint64_t pressed;
+        uint64_t changed;
+        Timestamp firstChangeTime;
+        Timestamp time;
+    };
+
+    Block _blocks[2] = {};
+    volatile uint32_t _seq = 0;     // 最後に書き込み終わったseq、_blocks[_seq & 1]に入っている
+    volatile uint32_t _readSeq = 0; // 読み出し側が最後に読んだseq
+    volatile uint32_t _mergeCount = 0;
+
+    // 書き込み側だけが使う
+    uint64_t _pressed = 0;
+    uint64_t _changed = 0;
+    uint32_t _baseSeq = 0;
+    Timestamp _firstChangeTime = 0;
+
+    // 読み出し側だけが使う
+    uint64_t _lastPressed = 0;
+};
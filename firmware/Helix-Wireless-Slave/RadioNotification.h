@@ -0,0 +1,55 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "Timestamp.h"
+#include <Arduino.h>
+
+// SoftDeviceの無線の動作の通知(Radio Notification)で接続イベントの直前に起きるクラス
+// 無線が動き出すLEAD_US前に割り込みが入り、その時刻を覚えてcallbackを呼ぶ
+// SoftDeviceが使わないSWI1の割り込みハンドラを自前で定義する
+// スレーブレイテンシで飛ばす接続イベントの前には通知が来ない
+class RadioNotification {
+  public:
+    // 通知から無線が動き出すまでの時間
+    const static uint32_t LEAD_US = 1740;
+    const static Timestamp LEAD_TIME = (LEAD_US * TIMESTAMP_FREQUENCY + 999999) / 1000000;
+
+    // SoftDeviceを有効にした後で呼ぶ、通知のたびに割り込みハンドラからcallbackを呼ぶ
+    void init(void (*callback)(BaseType_t *woken));
+
+    // 最後に通知が来た時刻、まだ来ていなければfalse
+    bool lastNotification(Timestamp &time) const;
+
+    // 割り込みハンドラから呼ばれる
+    void onInterrupt();
+
+  private:
+    void (*_callback)(BaseType_t *woken) = nullptr;
+    volatile Timestamp _lastTime = 0;
+    volatile bool _hasNotified = false;
+};
+
+extern RadioNotification radioNotification;
@@ -0,0 +1,89 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "ScanGovernor.h"
+
+void ScanGovernor::setBasePeriod(uint32_t basePeriod) {
+    if (basePeriod != 0) {
+        _basePeriod = basePeriod;
+    }
+}
+
+uint32_t ScanGovernor::basePeriod() const {
+    return _basePeriod;
+}
+
+void ScanGovernor::update(bool changing, bool held) {
+    // 前回のスキャンから今回までは今の段階の周期だったので、その分を加算する
+    uint32_t elapsed = period();
+    _stats.timeInLevel[_level] += elapsed;
+
+    if (changing) {
+        // 変化中は一番速く
+        _level = 0;
+        _stableTime = 0;
+        _idle = false;
+    } else if (held) {
+        // 押されたまま変化が無ければ段階的に遅くする
+        _stableTime += elapsed;
+        if (_level < MAX_LEVEL && _stableTime >= SCAN_BACKOFF_TIME * 1000UL) {
+            _level++;
+            _stableTime = 0;
+        }
+        _idle = false;
+    } else {
+        // 何も押されてなければスキャンを止める
+        _level = 0;
+        _stableTime = 0;
+        _idle = true;
+    }
+}
+
+void ScanGovernor::sleep(unsigned long now) {
+    _sleepTime = now;
+}
+
+void ScanGovernor::wakeup(unsigned long now) {
+    _stats.idleTime += (unsigned long)(now - _sleepTime) * 1000ULL;
+    _stats.wakeups++;
+    _level = 0;
+    _stableTime = 0;
+    _idle = false;
+}
+
+uint32_t ScanGovernor::period() const {
+    return _basePeriod << _level;
+}
+
+uint8_t ScanGovernor::level() const {
+    return _level;
+}
+
+bool ScanGovernor::isIdle() const {
+    return _idle;
+}
+
+const ScanRateStats &ScanGovernor::stats() const {
+    return _stats;
+}
@@ -0,0 +1,77 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "config.h"
+#include <Arduino.h>
+
+// スキャン速度の段階ごとの滞在時間
+struct ScanRateStats {
+    // 段階ごとのスキャンしていた時間 (us)、0が一番速い
+    uint64_t timeInLevel[SCAN_BACKOFF_LEVELS + 1];
+    // スキャンせずに割り込みを待っていた時間 (us)
+    uint64_t idleTime;
+    // 割り込みで起きた回数
+    uint32_t wakeups;
+};
+
+// キースキャンの速さを決めるクラス
+//   スイッチの状態が変化中           : 基本の周期でスキャン
+//   押されたまま変化が無い           : SCAN_BACKOFF_TIMEごとに周期を倍にしていく (最大SCAN_BACKOFF_LEVELS段)
+//   何も押されていなくて変化も無い   : スキャンを止めて割り込みを待つ
+class ScanGovernor {
+  public:
+    static const uint8_t MAX_LEVEL = SCAN_BACKOFF_LEVELS;
+
+    void setBasePeriod(uint32_t basePeriod);
+
+    uint32_t basePeriod() const;
+
+    // スキャン1回分の結果を渡して次のスキャンの速さを決める
+    //   changing : 状態が変わったか、チャタリング除去中のスイッチがある
+    //   held     : 押されているスイッチがある
+    void update(bool changing, bool held);
+
+    // 割り込みを待って寝る時と起きた時に呼ぶ、nowはms
+    void sleep(unsigned long now);
+    void wakeup(unsigned long now);
+
+    // 次のスキャンまでの周期(us)、isIdleの時は意味を持たない
+    uint32_t period() const;
+
+    uint8_t level() const;
+
+    bool isIdle() const;
+
+    const ScanRateStats &stats() const;
+
+  private:
+    uint32_t _basePeriod = SCAN_PERIOD;
+    uint8_t _level = 0;
+    bool _idle = false;
+    uint32_t _stableTime = 0;
+    unsigned long _sleepTime = 0;
+    ScanRateStats _stats = {};
+};
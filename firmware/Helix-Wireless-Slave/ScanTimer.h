@@ -0,0 +1,65 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "Timestamp.h"
+#include <Arduino.h>
+
+// RTC2のコンペアイベントでキースキャンの周期を作るクラス
+// RTC2はLFCLK(32768Hz、1カウント約30.5us)で動くのでHFCLKを起こさずに済み、
+// 次のコンペア値を前回のコンペア値に周期を足して決めるのでタスクのスケジューリングで周期がずれない
+// RTC2のカウンターは止めずに動かして、オーバーフローを数えて32ビットに拡張した物を時刻(Timestamp)として使う
+class ScanTimer {
+  public:
+    // callbackは周期ごとに割り込みハンドラから呼ばれる
+    void init(void (*callback)(BaseType_t *woken), uint32_t periodUs);
+
+    // 今から1周期後を最初として周期的にcallbackを呼び出し始める
+    void start();
+
+    void stop();
+
+    // 周期を変更する、次のコンペアイベントから反映される
+    void setPeriod(uint32_t periodUs);
+
+    uint32_t period() const;
+
+    // 現在の時刻
+    Timestamp timestamp() const;
+
+    // 割り込みハンドラから呼ばれる
+    void onInterrupt();
+
+  private:
+    void (*_callback)(BaseType_t *woken) = nullptr;
+    volatile uint32_t _periodUs = 0;
+    // 周期と次のコンペア時刻、RTCのカウントを256倍した固定小数点で持って端数を積み上げる
+    volatile uint32_t _periodQ8 = 0;
+    uint32_t _nextQ8 = 0;
+    volatile bool _running = false;
+    volatile uint32_t _overflows = 0;
+};
+
+extern ScanTimer scanTimer;
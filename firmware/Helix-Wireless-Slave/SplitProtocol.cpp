@@ -0,0 +1,243 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "SplitProtocol.h"
+
+static uint8_t crc8(const uint8_t *data, size_t size) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// 押されているIDのビットを8バイトのリトルエンディアンにしたもののCRC-8
+static uint8_t stateHash(uint64_t pressed) {
+    uint8_t bytes[8];
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = (uint8_t)(pressed >> (i * 8));
+    }
+    return crc8(bytes, sizeof(bytes));
+}
+
+static void writeTimestamp(uint8_t *p, Timestamp time) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(time >> (i * 8));
+    }
+}
+
+static Timestamp readTimestamp(const uint8_t *p) {
+    Timestamp time = 0;
+    for (int i = 0; i < 4; i++) {
+        time |= (Timestamp)p[i] << (i * 8);
+    }
+    return time;
+}
+
+/*------------------------------------------------------------------*/
+/* SplitFrameEncoder
+ *------------------------------------------------------------------*/
+bool SplitFrameEncoder::addChanges(uint64_t pressed, Timestamp time) {
+    uint64_t changed = _queued ^ pressed;
+    if (changed == 0) {
+        return true;
+    }
+    if (_changeCount + __builtin_popcountll(changed) > SPLIT_DELTA_MAX_CHANGES ||
+        (_changeCount != 0 && time - _changeTimes[0] > SPLIT_DELTA_MAX_SPAN)) {
+        return false;
+    }
+    // 離された物を先に入れる
+    uint64_t released = changed & ~pressed;
+    while (released != 0) {
+        _changeTimes[_changeCount] = time;
+        _changes[_changeCount++] = __builtin_ctzll(released);
+        released &= released - 1;
+    }
+    uint64_t newlyPressed = changed & pressed;
+    while (newlyPressed != 0) {
+        _changeTimes[_changeCount] = time;
+        _changes[_changeCount++] = 0x80 | __builtin_ctzll(newlyPressed);
+        newlyPressed &= newlyPressed - 1;
+    }
+    _queued = pressed;
+    return true;
+}
+
+size_t SplitFrameEncoder::encodeDelta(uint8_t *buf) {
+    if (_changeCount == 0) {
+        return 0;
+    }
+    uint8_t *payload = buf + SPLIT_FRAME_HEADER_SIZE;
+    Timestamp time = _changeTimes[_changeCount - 1];
+    writeTimestamp(payload, time);
+    size_t size = 4;
+    for (size_t i = 0; i < _changeCount; i++) {
+        payload[size++] = _changes[i];
+        payload[size++] = (uint8_t)((time - _changeTimes[i]) / SPLIT_DELTA_TIME_UNIT);
+    }
+    _changeCount = 0;
+    _sent = _queued;
+    return finish(DELTA_FRAME, _seq++, buf, size);
+}
+
+size_t SplitFrameEncoder::encodeSnapshot(uint64_t pressed, Timestamp time, uint8_t *buf) {
+    uint8_t *payload = buf + SPLIT_FRAME_HEADER_SIZE;
+    writeTimestamp(payload, time);
+    for (int i = 0; i < 8; i++) {
+        payload[4 + i] = (uint8_t)(pressed >> (i * 8));
+    }
+    _changeCount = 0;
+    _sent = _queued = pressed;
+    return finish(SNAPSHOT_FRAME, _seq++, buf, 12);
+}
+
+size_t SplitFrameEncoder::encodeHeartbeat(uint8_t *buf) {
+    buf[SPLIT_FRAME_HEADER_SIZE] = stateHash(_sent);
+    return finish(HEARTBEAT_FRAME, _seq, buf, 1);
+}
+
+size_t SplitFrameEncoder::encodeResyncRequest(uint8_t *buf) {
+    return finish(RESYNC_REQUEST_FRAME, 0, buf, 0);
+}
+
+size_t SplitFrameEncoder::encodeTimeRequest(Timestamp requestTime, uint8_t *buf) {
+    writeTimestamp(buf + SPLIT_FRAME_HEADER_SIZE, requestTime);
+    return finish(TIME_REQUEST_FRAME, 0, buf, 4);
+}
+
+size_t SplitFrameEncoder::encodeTimeResponse(const TimeSyncSample &sample, uint8_t *buf) {
+    uint8_t *payload = buf + SPLIT_FRAME_HEADER_SIZE;
+    writeTimestamp(payload, sample.requestTime);
+    writeTimestamp(payload + 4, sample.receiveTime);
+    writeTimestamp(payload + 8, sample.responseTime);
+    return finish(TIME_RESPONSE_FRAME, 0, buf, 12);
+}
+
+size_t SplitFrameEncoder::finish(SplitFrameType type, uint8_t seq, uint8_t *buf, size_t payloadSize) {
+    buf[0] = (type << 5) | payloadSize;
+    buf[1] = seq;
+    size_t size = SPLIT_FRAME_HEADER_SIZE + payloadSize;
+    buf[size] = crc8(buf, size);
+    return size + 1;
+}
+
+/*------------------------------------------------------------------*/
+/* SplitFrameDecoder
+ *------------------------------------------------------------------*/
+bool SplitFrameDecoder::decode(const uint8_t *frame, size_t size) {
+    size_t payloadSize = (size != 0) ? (frame[0] & 0x1f) : 0;
+    if (size < SPLIT_FRAME_HEADER_SIZE + 1 ||
+        payloadSize > SPLIT_FRAME_MAX_PAYLOAD ||
+        size != SPLIT_FRAME_HEADER_SIZE + payloadSize + 1 ||
+        crc8(frame, size - 1) != frame[size - 1]) {
+        // 何が抜けたか分からないので全部送ってもらう
+        _stats.badFrames++;
+        requestResync();
+        return false;
+    }
+
+    SplitFrameType type = static_cast<SplitFrameType>(frame[0] >> 5);
+    uint8_t seq = frame[1];
+    const uint8_t *payload = frame + SPLIT_FRAME_HEADER_SIZE;
+    if (type == DELTA_FRAME && payloadSize >= 6 && (payloadSize - 4) % 2 == 0) {
+        if (_hasSeq && seq != _expectedSeq) {
+            // 抜けたフレームの分は分からないが、分かる変化は反映してSNAPSHOT_FRAMEで正しい状態に戻す
+            _stats.gaps++;
+            requestResync();
+        }
+        _time = readTimestamp(payload);
+        _changeCount = 0;
+        for (size_t i = 4; i < payloadSize; i += 2) {
+            uint64_t bit = 1ULL << (payload[i] & 0x3f);
+            if (payload[i] & 0x80) {
+                _pressed |= bit;
+            } else {
+                _pressed &= ~bit;
+            }
+            _changedPressed[_changeCount] = _pressed;
+            _changeTimes[_changeCount++] = _time - payload[i + 1] * SPLIT_DELTA_TIME_UNIT;
+        }
+        _expectedSeq = seq + 1;
+        _hasSeq = true;
+    } else if (type == SNAPSHOT_FRAME && payloadSize == 12) {
+        _time = readTimestamp(payload);
+        _pressed = 0;
+        for (int i = 0; i < 8; i++) {
+            _pressed |= (uint64_t)payload[4 + i] << (i * 8);
+        }
+        _expectedSeq = seq + 1;
+        _hasSeq = true;
+        _stats.snapshots++;
+    } else if (type == HEARTBEAT_FRAME && payloadSize == 1) {
+        // 番号が次の物でなければ最後の方のフレームが抜けている、番号が合っていてハッシュが違えば状態がずれている
+        if (_hasSeq) {
+            if (seq != _expectedSeq) {
+                _stats.gaps++;
+                requestResync();
+            } else if (payload[0] != stateHash(_pressed)) {
+                _stats.hashMismatches++;
+                requestResync();
+            }
+            _expectedSeq = seq;
+        }
+        _stats.heartbeats++;
+    } else if (type == TIME_REQUEST_FRAME && payloadSize == 4) {
+        _time = readTimestamp(payload);
+    } else if (type == TIME_RESPONSE_FRAME && payloadSize == 12) {
+        _timeSyncSample.requestTime = readTimestamp(payload);
+        _timeSyncSample.receiveTime = readTimestamp(payload + 4);
+        _timeSyncSample.responseTime = readTimestamp(payload + 8);
+    } else if (type != RESYNC_REQUEST_FRAME) {
+        // 知らない種類か長さが合わない、同じ版同士なら来ないので壊れた物として扱う
+        _stats.badFrames++;
+        requestResync();
+        return false;
+    }
+    _frameType = type;
+    _stats.frames++;
+    return true;
+}
+
+bool SplitFrameDecoder::takeResyncRequest() {
+    bool needsResync = _needsResync;
+    _needsResync = false;
+    return needsResync;
+}
+
+void SplitFrameDecoder::reset() {
+    _pressed = 0;
+    _changeCount = 0;
+    _hasSeq = false;
+    _needsResync = false;
+}
+
+void SplitFrameDecoder::requestResync() {
+    if (_needsResync == false) {
+        _needsResync = true;
+        _stats.resyncRequests++;
+    }
+}
@@ -0,0 +1,195 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "Timestamp.h"
+#include <Arduino.h>
+
+// スレーブとマスターの間で押されているIDをやり取りするフレームの形式
+//
+// +--------+-----+----------------+------+
+// | header | seq | payload (0-16) | crc8 |
+// +--------+-----+----------------+------+
+// header  上位3ビットがフレームの種類、下位5ビットがpayloadのバイト数
+// seq     DELTA_FRAMEとSNAPSHOT_FRAMEごとに1ずつ増える番号、抜けを見つけるのに使う (HEARTBEAT_FRAMEは次に使う番号)
+// crc8    headerからpayloadまでのCRC-8 (多項式0x07)
+//
+// payloadの時刻は送った側のTimestampを4バイトのリトルエンディアンで
+// DELTA_FRAME          最後の変化の時刻、続けて2バイトに1つの変化を変化した順に
+//                      1バイト目は最上位ビットが押された(1)か離された(0)か、下位6ビットがID - 1
+//                      2バイト目はその変化の時刻をフレームの時刻から遡った時間(SPLIT_DELTA_TIME_UNIT単位)
+// SNAPSHOT_FRAME       時刻、続けて押されているIDのビット(bit(id - 1))を8バイトのリトルエンディアンで
+// RESYNC_REQUEST_FRAME payload無し、受け取った側はSNAPSHOT_FRAMEを送る
+// TIME_REQUEST_FRAME   マスター側が送った時刻(t0)、受け取った側はTIME_RESPONSE_FRAMEを送る
+// TIME_RESPONSE_FRAME  t0、スレーブ側が受け取った時刻(t1)、スレーブ側が送った時刻(t2)
+// HEARTBEAT_FRAME      最後に送った状態のハッシュ(1バイト)、変化が無い間も繋がっていることと状態が合っていることを確かめる
+//
+// 1つのフレームは最大19バイトでBLEの1回の通知(デフォルトのMTUで20バイト)に収まるので、通知1回にフレーム1つで送る
+enum SplitFrameType : uint8_t {
+    DELTA_FRAME = 0,
+    SNAPSHOT_FRAME = 1,
+    RESYNC_REQUEST_FRAME = 2,
+    TIME_REQUEST_FRAME = 3,
+    TIME_RESPONSE_FRAME = 4,
+    HEARTBEAT_FRAME = 5,
+};
+
+const static size_t SPLIT_FRAME_HEADER_SIZE = 2;
+const static size_t SPLIT_FRAME_MAX_PAYLOAD = 16;
+const static size_t SPLIT_FRAME_MAX_SIZE = SPLIT_FRAME_HEADER_SIZE + SPLIT_FRAME_MAX_PAYLOAD + 1;
+
+// DELTA_FRAMEに入る変化の数
+const static size_t SPLIT_DELTA_MAX_CHANGES = (SPLIT_FRAME_MAX_PAYLOAD - 4) / 2;
+// DELTA_FRAMEの変化の時刻の単位 (4/32768秒 = 約122us)、1バイトでフレームの時刻から約31ms遡れる
+const static Timestamp SPLIT_DELTA_TIME_UNIT = 4;
+const static Timestamp SPLIT_DELTA_MAX_SPAN = SPLIT_DELTA_TIME_UNIT * 255;
+
+// 時刻合わせの1回のやり取りの時刻
+struct TimeSyncSample {
+    Timestamp requestTime;  // t0 マスター側の時計
+    Timestamp receiveTime;  // t1 スレーブ側の時計
+    Timestamp responseTime; // t2 スレーブ側の時計
+};
+
+// スレーブ側のGATTサービスとフレームをやり取りするキャラクタリスティックのUUID (BLEUuidに渡す順番)
+const static uint8_t SPLIT_SERVICE_UUID[16] = {
+    0x38, 0x6f, 0x9d, 0x5f, 0x67, 0x78, 0x47, 0x8d, 0xb0, 0x4f, 0xfd, 0x09, 0x77, 0x7d, 0x0b, 0x7d,
+};
+const static uint8_t SPLIT_FRAME_CHR_UUID[16] = {
+    0x38, 0x6f, 0x9d, 0x5f, 0x67, 0x78, 0x47, 0x8d, 0xb0, 0x4f, 0xfd, 0x09, 0x01, 0x00, 0x0b, 0x7d,
+};
+
+// 送る側、最後に送った状態と番号を持っている
+class SplitFrameEncoder {
+  public:
+    // 最後に加えた状態からtimeにpressedに変化した分を、次のDELTA_FRAMEに変化した順に加える
+    // 同時に変化した物は離された物を先に、それぞれID順に並べる
+    // 加えた変化と合わせてDELTA_FRAMEに入りきらないか、最初の変化から遡れないほど時間が経っていれば、何も加えずにfalse
+    bool addChanges(uint64_t pressed, Timestamp time);
+
+    // 加えてまだフレームにしていない変化があるか
+    bool hasChanges() const {
+        return _changeCount != 0;
+    }
+
+    // 加えた変化をDELTA_FRAMEにする、変化が無ければ0、それ以外はフレームのバイト数
+    size_t encodeDelta(uint8_t *buf);
+
+    // 加えてまだフレームにしていない変化も含めて送る
+    size_t encodeSnapshot(uint64_t pressed, Timestamp time, uint8_t *buf);
+
+    // 最後に送った状態のハッシュ、番号は進めない
+    size_t encodeHeartbeat(uint8_t *buf);
+
+    static size_t encodeResyncRequest(uint8_t *buf);
+    static size_t encodeTimeRequest(Timestamp requestTime, uint8_t *buf);
+    static size_t encodeTimeResponse(const TimeSyncSample &sample, uint8_t *buf);
+
+  private:
+    static size_t finish(SplitFrameType type, uint8_t seq, uint8_t *buf, size_t payloadSize);
+
+    uint8_t _seq = 0;
+    uint64_t _sent = 0;   // 最後にフレームにした状態
+    uint64_t _queued = 0; // 加えた変化も反映した状態
+    uint8_t _changes[SPLIT_DELTA_MAX_CHANGES];
+    Timestamp _changeTimes[SPLIT_DELTA_MAX_CHANGES];
+    size_t _changeCount = 0;
+};
+
+// 受け取る側の統計
+struct SplitLinkStats {
+    uint32_t frames;         // 正しく受け取ったフレーム
+    uint32_t snapshots;      // その内のSNAPSHOT_FRAME
+    uint32_t gaps;           // seqが飛んでいた回数
+    uint32_t badFrames;      // 長さかCRCが合わずに捨てたフレーム
+    uint32_t resyncRequests; // SNAPSHOT_FRAMEを要求した回数
+    uint32_t heartbeats;     // その内のHEARTBEAT_FRAME
+    uint32_t hashMismatches; // HEARTBEAT_FRAMEのハッシュが受け取った状態と合わなかった回数
+};
+
+// 受け取る側、通知で受け取ったバッファをコピーせずにそのまま読む
+class SplitFrameDecoder {
+  public:
+    // 1つのフレームを状態に反映する、壊れていて捨てたらfalse
+    bool decode(const uint8_t *frame, size_t size);
+
+    // 最後に反映したフレームの種類
+    SplitFrameType frameType() const {
+        return _frameType;
+    }
+
+    // 受け取ったフレームを反映した押されているID
+    uint64_t pressed() const {
+        return _pressed;
+    }
+
+    // 最後のDELTA_FRAMEかSNAPSHOT_FRAMEの送った側の時刻、TIME_REQUEST_FRAMEならt0
+    Timestamp time() const {
+        return _time;
+    }
+
+    // 最後のDELTA_FRAMEの変化の数
+    size_t changeCount() const {
+        return _changeCount;
+    }
+
+    // 最後のDELTA_FRAMEのi番目(変化した順)の変化までを反映した押されているIDと、その変化の送った側の時刻
+    uint64_t changedPressed(size_t i) const {
+        return _changedPressed[i];
+    }
+    Timestamp changeTime(size_t i) const {
+        return _changeTimes[i];
+    }
+
+    // 最後のTIME_RESPONSE_FRAMEの時刻
+    const TimeSyncSample &timeSyncSample() const {
+        return _timeSyncSample;
+    }
+
+    // 抜けや壊れたフレームを見つけたらSNAPSHOT_FRAMEを要求する、1回だけtrueを返す
+    bool takeResyncRequest();
+
+    // 接続し直した時などに呼ぶ、押されているIDも無しにする
+    void reset();
+
+    const SplitLinkStats &stats() const {
+        return _stats;
+    }
+
+  private:
+    void requestResync();
+
+    SplitFrameType _frameType = DELTA_FRAME;
+    uint64_t _pressed = 0;
+    Timestamp _time = 0;
+    uint64_t _changedPressed[SPLIT_DELTA_MAX_CHANGES];
+    Timestamp _changeTimes[SPLIT_DELTA_MAX_CHANGES];
+    size_t _changeCount = 0;
+    TimeSyncSample _timeSyncSample = {};
+    uint8_t _expectedSeq = 0;
+    bool _hasSeq = false; // resetの後で番号付きのフレームを受け取ったか
+    bool _needsResync = false;
+    SplitLinkStats _stats = {};
+};
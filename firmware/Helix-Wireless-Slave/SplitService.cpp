@@ -22,21 +22,29 @@
   THE SOFTWARE.
 */
 
-#include "Switch.h"
+#include "SplitService.h"
 
-Switch::Switch(int pin, uint8_t id) : _pin(pin), _id(id), _bounce() {}
+SplitService::SplitService()
+    : BLEService(SPLIT_SERVICE_UUID), _frame(SPLIT_FRAME_CHR_UUID) {
+}
+
+err_t SplitService::begin() {
+    VERIFY_STATUS(BLEService::begin());
+
+    _frame.setProperties(CHR_PROPS_NOTIFY | CHR_PROPS_WRITE_WO_RESP);
+    _frame.setPermission(SECMODE_OPEN, SECMODE_OPEN);
+    _frame.setMaxLen(SPLIT_FRAME_MAX_SIZE);
+    _frame.setWriteCallback(frame_write_callback);
+    VERIFY_STATUS(_frame.begin());
+
+    return ERROR_NONE;
+}
 
-void Switch::init() {
-    _bounce.attach(_pin);
-    _bounce.interval(DEBOUNCE_DELAY);
+bool SplitService::send(const uint8_t *frame, size_t size) {
+    return _frame.notify(frame, size);
 }
 
-void Switch::update(UInt8Set &ids) {
-    if (_bounce.update()) {
-        if (_bounce.read() == LOW) {
-            ids.add(_id);
-        } else {
-            ids.remove(_id);
-        }
-    }
+void SplitService::frame_write_callback(BLECharacteristic &chr, uint8_t *data, uint16_t len, uint16_t offset) {
+    SplitService &svc = (SplitService &)chr.parentService();
+    svc.received(data, len);
 }
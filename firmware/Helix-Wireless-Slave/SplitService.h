@@ -0,0 +1,47 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "SplitLink.h"
+#include "SplitProtocol.h"
+#include <bluefruit.h>
+
+// マスター側とフレームをやり取りするGATTサービス、SplitLinkのスレーブ側のBLEの実装
+// キャラクタリスティックは1つで、スレーブ側からはnotifyでフレームを送り、マスター側からはwrite without responseで要求のフレームを受け取る
+// 受け取りのコールバックはBLEのタスクから呼ばれる
+class SplitService : public BLEService, public SplitLink {
+  public:
+    SplitService();
+
+    virtual err_t begin();
+
+    // 通知1回でフレームを1つ送る、マスター側が通知を有効にしていなければfalse
+    bool send(const uint8_t *frame, size_t size) override;
+
+  private:
+    static void frame_write_callback(BLECharacteristic &chr, uint8_t *data, uint16_t len, uint16_t offset);
+
+    BLECharacteristic _frame;
+};
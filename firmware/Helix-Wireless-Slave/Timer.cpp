@@ -23,29 +23,106 @@
 */
 
 #include "Timer.h"
-#include "queues.h"
 
-static void timeout(TimerHandle_t timer) {
-    // Software Timersのスタックを消費しないようにstaticで宣言
-    static EventData data = {
-        .eventType = TIMER_EVENT,
-    };
-    data.timer = reinterpret_cast<Timer *>(pvTimerGetTimerID(timer));
-    xQueueSend(eventQueue, &data, portMAX_DELAY);
+Timer *Timer::_head = nullptr;
+bool Timer::_isFiring = false;
+Timestamp Timer::_firingDeadline = 0;
+
+Timer::Timer(uint ms, bool autoReload)
+    : _period(msToTimestamp(ms)), _autoReload(autoReload) {
+}
+
+bool Timer::nextDeadline(Timestamp &deadline) {
+    if (_head == nullptr) {
+        return false;
+    }
+    deadline = _head->_deadline;
+    return true;
+}
+
+TickType_t Timer::ticksUntilNextDeadline() {
+    Timestamp deadline;
+    if (nextDeadline(deadline) == false) {
+        return portMAX_DELAY;
+    }
+    return ticksUntil(deadline);
+}
+
+TickType_t Timer::ticksUntil(Timestamp time) {
+    int32_t remaining = (int32_t)(time - currentTimestamp());
+    if (remaining <= 0) {
+        return 0;
+    }
+    // timeより前に起きないように切り上げる
+    return (TickType_t)(((uint64_t)remaining * configTICK_RATE_HZ + TIMESTAMP_FREQUENCY - 1) / TIMESTAMP_FREQUENCY);
+}
+
+Timer *Timer::nextExpired(Timestamp time) {
+    if (_head != nullptr && (int32_t)(_head->_deadline - time) <= 0) {
+        return _head;
+    }
+    return nullptr;
 }
 
-Timer::Timer(uint ms, bool autoReload) {
-    _th = xTimerCreate(NULL, ms2tick(ms), autoReload, this, timeout);
+void Timer::fire() {
+    Timestamp deadline = _deadline;
+    remove();
+    if (_autoReload) {
+        // 発火が遅れてもずれが溜まらないように前の期限から次の期限を決める
+        _deadline = deadline + _period;
+        insert();
+    }
+    _isFiring = true;
+    _firingDeadline = deadline;
+    onTimer();
+    _isFiring = false;
 }
 
 void Timer::startTimer() {
-    xTimerStart(_th, 0);
+    startTimerAt(now() + _period);
+}
+
+void Timer::startTimerAt(Timestamp deadline) {
+    if (_isActive) {
+        remove();
+    }
+    _deadline = deadline;
+    insert();
 }
 
 void Timer::stopTimer() {
-    xTimerStop(_th, 0);
+    if (_isActive) {
+        remove();
+    }
 }
 
 void Timer::changePeriod(uint ms) {
-    xTimerChangePeriod(_th, ms2tick(ms), 0);
+    _period = msToTimestamp(ms);
+    startTimer();
+}
+
+void Timer::insert() {
+    // 同じ期限なら先に開始した方を先に発火させる
+    Timer **p = &_head;
+    while (*p != nullptr && (int32_t)((*p)->_deadline - _deadline) <= 0) {
+        p = &(*p)->_next;
+    }
+    _next = *p;
+    *p = this;
+    _isActive = true;
+}
+
+void Timer::remove() {
+    for (Timer **p = &_head; *p != nullptr; p = &(*p)->_next) {
+        if (*p == this) {
+            *p = _next;
+            break;
+        }
+    }
+    _next = nullptr;
+    _isActive = false;
+}
+
+Timestamp Timer::now() {
+    return _isFiring ? _firingDeadline : currentTimestamp();
 }
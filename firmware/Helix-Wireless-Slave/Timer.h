@@ -24,18 +24,58 @@
 
 #pragma once
 
+#include "Timestamp.h"
 #include <Arduino.h>
 
+// loopTaskの中だけで使うタイマー
+// 動いているタイマーは期限の早い順に1本のリストに繋がれていて、loopTaskは先頭の期限まで待って期限の来た物から順に発火させる
+// RTOSのタイマーと違いタイマーごとのヒープ確保やタスクの切り替えは無い
 class Timer {
   public:
     virtual void onTimer() {}
 
+    // 先頭のタイマーの期限、動いているタイマーが無ければfalse
+    static bool nextDeadline(Timestamp &deadline);
+
+    // 先頭のタイマーの期限までのtick数、期限が過ぎていれば0、無ければportMAX_DELAY
+    static TickType_t ticksUntilNextDeadline();
+
+    // timeまでのtick数(切り上げ)、過ぎていれば0
+    static TickType_t ticksUntil(Timestamp time);
+
+    // time以前に期限が来た先頭のタイマー、無ければnullptr
+    static Timer *nextExpired(Timestamp time);
+
+    // リストから外して(自動再開なら次の期限で入れ直して)onTimerを呼ぶ
+    void fire();
+
+    Timestamp deadline() const {
+        return _deadline;
+    }
+
   protected:
     Timer(uint ms, bool autoReload);
+    // 今から周期で開始する、動いていれば期限を延ばす
     void startTimer();
+    // 期限を指定して開始する
+    void startTimerAt(Timestamp deadline);
     void stopTimer();
+    // 周期を変えて今から開始する
     void changePeriod(uint ms);
 
   private:
-    TimerHandle_t _th;
+    void insert();
+    void remove();
+    // 期限を決める基準の時刻、onTimerの中なら発火させた期限
+    static Timestamp now();
+
+    static Timer *_head;
+    static bool _isFiring;
+    static Timestamp _firingDeadline;
+
+    Timer *_next = nullptr;
+    Timestamp _deadline = 0;
+    uint32_t _period;
+    const bool _autoReload;
+    bool _isActive = false;
 };
@@ -24,22 +24,23 @@
 
 #pragma once
 
-#include "Bounce2.h"
-#include "Uint8Set.h"
-#include "config.h"
-
-// 物理的なスイッチ1個に対応するクラス
-class Switch {
-  public:
-    // 入力ピン番号と、論理的なキーID(1~255(0からではない))をセットする
-    Switch(int pin, uint8_t id);
-    // 初期化関数
-    void init();
-    // スキャン時に呼ばれる、押されてるかを自分でチェックして自分のIDをセットする
-    void update(UInt8Set &ids);
-
-  private:
-    int _pin;
-    uint8_t _id;
-    Bounce _bounce;
-};
+#include <Arduino.h>
+
+// キー入力などの時刻
+// RTC2のカウンター(32768Hz、1カウント約30.5us)を32ビットに拡張した物で、約36時間で一周するので比較は差で行う
+typedef uint32_t Timestamp;
+
+const static uint32_t TIMESTAMP_FREQUENCY = 32768;
+
+// 現在の時刻
+Timestamp currentTimestamp();
+
+// msを時刻の差に変換する (切り上げ)
+constexpr uint32_t msToTimestamp(uint32_t ms) {
+    return (uint32_t)(((uint64_t)ms * TIMESTAMP_FREQUENCY + 999) / 1000);
+}
+
+// 時刻の差をmsに変換する (切り捨て)
+constexpr uint32_t timestampToMs(uint32_t ticks) {
+    return (uint32_t)((uint64_t)ticks * 1000 / TIMESTAMP_FREQUENCY);
+}
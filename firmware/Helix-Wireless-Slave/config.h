@@ -37,9 +37,37 @@
 // BLEの送信電波強度: -40, -30, -20, -16, -12, -8, -4, 0, 4
 #define TX_POWER -12
 
+// マスター側との接続の間隔の希望 (1.25ms単位)
+// マスター側がキー入力に合わせてACTIVEとIDLEの間隔を切り替えるので、両方を含む範囲にしておく
+#define SPLIT_LINK_INTERVAL_MIN 6
+#define SPLIT_LINK_INTERVAL_MAX 48
+
 // LEDの点滅間隔、省電力のためにOFFの方を長めにしてある
 #define TURN_ON_INTERVAL 100
 #define TURN_OFF_INTERVAL 800
 
 // cherry mx bounce time is <= 5ms
 #define DEBOUNCE_DELAY 6
+
+// キースキャン中のスキャン周期の初期値 (us)、setScanPeriodで実行時に変更できる
+#define SCAN_PERIOD 3000
+
+// キーが押されたまま変化が無い時は、SCAN_BACKOFF_TIME(ms)ごとにスキャン周期を倍にしていく
+// 最大でSCAN_BACKOFF_LEVELS回まで倍にする
+#define SCAN_BACKOFF_TIME 50
+#define SCAN_BACKOFF_LEVELS 3
+
+// 変化が無くてもマスター側に押されているIDを全部送る間隔 (ms)、通知が抜けても押しっぱなしにならないようにする
+#define SNAPSHOT_INTERVAL 5000
+
+// 押されているIDを送った後に何も送らずにいると、最後に送った状態のハッシュを送る間隔 (ms)
+// キーが押されている間はHEARTBEAT_INTERVALで送り、マスター側は届かなくなると押されているキーを離す
+// 何も押されていない時は送るたびに倍にしてHEARTBEAT_IDLE_INTERVALまで延ばす
+#define HEARTBEAT_INTERVAL 200
+#define HEARTBEAT_IDLE_INTERVAL 1600
+
+// キーの変化をすぐに送らずに、次の接続イベントの直前(無線の動作の通知)にまとめて1つのフレームで送る
+// 次の通知は最後の通知から接続間隔ごとに来ると予想して、それまでこの時間(ms)より長く待つ時は待たずに送る
+// マスター側のACTIVEの接続間隔(最大10ms、PCとの接続に合わせる時もこれを超えない)より長くしておく、0なら待たずにすぐ送る
+// スレーブレイテンシがある間は接続イベントを飛ばすので通知を当てにせずに送る
+#define TX_COALESCING_LIMIT 15
@@ -24,8 +24,80 @@
 
 #include "queues.h"
 
-QueueHandle_t eventQueue;
+KeyStateMailbox scanStateMailbox;
+
+static KeyStateMailbox *const mailboxes[] = {&scanStateMailbox};
+
+const static int MAILBOX_COUNT = sizeof(mailboxes) / sizeof(mailboxes[0]);
+
+// 読み出したがまだ返していない状態、別のメールボックスの方が早く変化していたら後で返す
+static KeyState pendingStates[MAILBOX_COUNT];
+static bool hasPendingState[MAILBOX_COUNT];
+
+static TaskHandle_t loopTaskHandle;
+
+// wakeLoopTaskされてからreceiveKeyStateが返るまでtrue
+static volatile bool isWakeupRequested = false;
 
 void initQueues() {
-    eventQueue = xQueueCreate(64, sizeof(EventData));
+    loopTaskHandle = xTaskGetCurrentTaskHandle();
+}
+
+void publishKeyState(KeyStateMailbox &mailbox, uint64_t pressed, Timestamp time) {
+    mailbox.publish(pressed, time);
+    xTaskNotifyGive(loopTaskHandle);
+}
+
+bool receiveKeyState(KeyState &state, TickType_t ticksToWait) {
+    TickType_t start = xTaskGetTickCount();
+    while (1) {
+        int earliest = -1;
+        for (int i = 0; i < MAILBOX_COUNT; i++) {
+            if (hasPendingState[i] == false) {
+                hasPendingState[i] = mailboxes[i]->read(pendingStates[i]);
+            }
+            if (hasPendingState[i] == false) {
+                continue;
+            }
+            if (earliest == -1 || (int32_t)(pendingStates[i].firstChangeTime - pendingStates[earliest].firstChangeTime) < 0) {
+                earliest = i;
+            }
+        }
+        if (earliest != -1) {
+            state = pendingStates[earliest];
+            hasPendingState[earliest] = false;
+            return true;
+        }
+        if (isWakeupRequested) {
+            isWakeupRequested = false;
+            return false;
+        }
+        // 更新が無ければ通知が来るまで寝る、確認した後に書き込まれた物は通知が残っているのですぐ起きる
+        // 読み出し済みの物の通知が残っていて更新が無いまま起きることもあるので、待つ時間は最初からの経過で決める
+        TickType_t wait = portMAX_DELAY;
+        if (ticksToWait != portMAX_DELAY) {
+            TickType_t elapsed = xTaskGetTickCount() - start;
+            if (elapsed >= ticksToWait) {
+                return false;
+            }
+            wait = ticksToWait - elapsed;
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+void wakeLoopTask() {
+    isWakeupRequested = true;
+    xTaskNotifyGive(loopTaskHandle);
+}
+
+void wakeLoopTaskFromISR(BaseType_t *woken) {
+    isWakeupRequested = true;
+    vTaskNotifyGiveFromISR(loopTaskHandle, woken);
+}
+
+MailboxStats mailboxStats() {
+    MailboxStats stats;
+    stats.scanMerges = scanStateMailbox.mergeCount();
+    return stats;
 }
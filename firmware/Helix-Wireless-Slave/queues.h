@@ -24,24 +24,34 @@
 
 #pragma once
 
-#include "Timer.h"
-#include "Uint8Set.h"
+#include "KeyStateMailbox.h"
 #include <Arduino.h>
 
-// loopTaskとやり取りするキューとデータの定義
-extern QueueHandle_t eventQueue;
+// loopTaskとやり取りする状態の定義
+// 送る側(タスク)ごとに1つずつメールボックスを持ち、最新の状態を書き込んだらタスク通知でloopTaskを起こす
+// loopTaskは更新されたメールボックスを変化の時刻順に読み出す
+// 送る側ごとの最新の状態
+extern KeyStateMailbox scanStateMailbox; // keyScanTask
 
-enum EventType {
-    SCAN_KEY_EVENT,
-    TIMER_EVENT,
-};
+// loopTaskから呼ぶ
+void initQueues();
+
+// mailboxに書き込んでloopTaskを起こす、待つことは無いのでBLEのコールバックからも呼べる
+void publishKeyState(KeyStateMailbox &mailbox, uint64_t pressed, Timestamp time);
+
+// 更新されたメールボックスのうち一番早く変化した物を読み出す、どれも更新されていなければticksToWaitまで待つ
+// wakeLoopTaskされていて更新が無ければすぐfalse
+bool receiveKeyState(KeyState &state, TickType_t ticksToWait);
 
-struct EventData {
-    enum EventType eventType;
-    union {
-        UInt8Set ids; // SCAN_KEY_EVENT
-        Timer *timer; // TIMER_EVENT
-    };
+// キーの状態以外の用事でloopTaskを起こす、BLEのコールバックから呼ぶ
+void wakeLoopTask();
+
+// 割り込みハンドラから呼ぶwakeLoopTask
+void wakeLoopTaskFromISR(BaseType_t *woken);
+
+// メールボックスごとの、loopTaskが読む前に次の書き込みでまとめられた回数
+struct MailboxStats {
+    uint32_t scanMerges; // scanStateMailbox
 };
 
-void initQueues();
+MailboxStats mailboxStats();
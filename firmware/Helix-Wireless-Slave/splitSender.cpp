@@ -0,0 +1,306 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#include "splitSender.h"
+#include "RadioNotification.h"
+#include "SplitProtocol.h"
+#include "Timer.h"
+#include "config.h"
+#include "queues.h"
+
+static SplitLink *splitLink;
+// 送る時刻を読む関数、普段はcurrentTimestamp
+static Timestamp (*timestamp)() = currentTimestamp;
+
+static SplitFrameEncoder encoder;
+// 押されているID (まだ送っていない変化も含む)
+static uint64_t pressedIDs = 0;
+
+// まだ送っていない変化はencoderに変化した順に加えておき、次の接続イベントの直前にまとめて1つのフレームで送る
+// 割り込みハンドラは送る物がある時だけloopTaskを起こす
+static volatile bool hasUnsentChanges = false;
+// 接続間隔(1.25ms単位)、スレーブレイテンシがある間と切断している間は0
+static volatile uint16_t connectionInterval = 0;
+// 最後に接続イベントの直前の通知が来た時刻
+static volatile Timestamp lastNotificationTime = 0;
+static volatile bool hasNotified = false;
+static TxCoalescingStats coalescingStats = {};
+
+// マスター側に押されているIDを全部送るか、BLEのコールバックから要求されてloopで送る
+static volatile bool isSnapshotRequested = false;
+
+// マスター側からの時刻合わせの要求、受け取った時刻を覚えておいてloopで返事をする
+static TimeSyncSample timeSyncSample;
+static volatile bool isTimeResponseRequested = false;
+
+static void requestSnapshot() {
+    isSnapshotRequested = true;
+    wakeLoopTask();
+}
+
+static void connection_callback(bool isConnected) {
+    if (isConnected) {
+        // 接続し直したらマスター側の状態は分からないので全部送る
+        requestSnapshot();
+    }
+}
+
+// マスター側からの要求
+static void receive_callback(const uint8_t *frame, size_t size) {
+    Timestamp time = timestamp();
+    static SplitFrameDecoder decoder;
+    if (decoder.decode(frame, size) == false) {
+        return;
+    }
+    if (decoder.frameType() == RESYNC_REQUEST_FRAME) {
+        // フレームの抜けを見つけたら送られてくる
+        requestSnapshot();
+    } else if (decoder.frameType() == TIME_REQUEST_FRAME) {
+        taskENTER_CRITICAL();
+        timeSyncSample.requestTime = decoder.time();
+        timeSyncSample.receiveTime = time;
+        isTimeResponseRequested = true;
+        taskEXIT_CRITICAL();
+        wakeLoopTask();
+    }
+}
+
+static void sendHeartbeat() {
+    uint8_t buf[SPLIT_FRAME_MAX_SIZE];
+    size_t size = encoder.encodeHeartbeat(buf);
+    splitLink->send(buf, size);
+}
+
+// 押されているIDを送ってから何も送っていなければハッシュを送る
+// キーが押されている間は一定間隔で、何も押されていなければ間隔を倍にしていく
+class HeartbeatTimer : public Timer {
+  public:
+    HeartbeatTimer() : Timer(HEARTBEAT_INTERVAL, false) {
+    }
+
+    // 押されているIDを送った時に呼ぶ、間隔を最初に戻して今から数える
+    void restart() {
+        _interval = HEARTBEAT_INTERVAL;
+        changePeriod(_interval);
+    }
+
+    void onTimer() override {
+        sendHeartbeat();
+        if (pressedIDs == 0 && _interval < HEARTBEAT_IDLE_INTERVAL) {
+            _interval = min(_interval * 2, (uint)HEARTBEAT_IDLE_INTERVAL);
+        }
+        changePeriod(_interval);
+    }
+
+  private:
+    uint _interval = HEARTBEAT_INTERVAL;
+};
+
+static HeartbeatTimer heartbeatTimer;
+
+static void flushChanges();
+
+// 変化をまとめている間に接続イベントの直前の通知が来なければ、待つのをやめて送る
+class CoalescingTimer : public Timer {
+  public:
+    CoalescingTimer() : Timer(TX_COALESCING_LIMIT, false) {
+    }
+
+    // タイマーは送る時刻の読み方に関係なくcurrentTimestampで数えるので、今からの時間で始める
+    void startAfter(Timestamp ticks) {
+        startTimerAt(currentTimestamp() + ticks);
+    }
+
+    void stop() {
+        stopTimer();
+    }
+
+    void onTimer() override {
+        coalescingStats.fallbacks++;
+        flushChanges();
+    }
+};
+
+static CoalescingTimer coalescingTimer;
+
+// 次の接続イベントまで送るのを待てるか、waitに次の通知が来るはずの時刻までの時間を入れる
+// 次の通知は最後の通知から接続間隔ごとに来ると予想する、予想した通知から無線が動き出すまでの間は今送ればその接続イベントに間に合うので待たない
+// 予想した通知が2回続けて来なければ、接続イベントを飛ばしているか切断されているので当てにしない
+static bool canDefer(Timestamp now, Timestamp &wait) {
+    // 1.25msは40.96カウントなので1/100カウント単位で数える
+    uint32_t interval = connectionInterval * 4096;
+    if (TX_COALESCING_LIMIT == 0 || interval == 0 || hasNotified == false) {
+        return false;
+    }
+    Timestamp elapsed = now - lastNotificationTime;
+    if (elapsed >= interval * 2 / 100) {
+        return false;
+    }
+    uint32_t phase = (elapsed * 100) % interval;
+    if (phase < RadioNotification::LEAD_TIME * 100) {
+        return false;
+    }
+    wait = (interval - phase + 99) / 100;
+    return wait <= msToTimestamp(TX_COALESCING_LIMIT);
+}
+
+// まとめた変化をマスター側に送る、マスター側は時刻合わせの結果で変化した時刻を自分の時刻に直す
+static void flushChanges() {
+    hasUnsentChanges = false;
+    coalescingTimer.stop();
+    uint8_t buf[SPLIT_FRAME_MAX_SIZE];
+    size_t size = encoder.encodeDelta(buf);
+    if (size != 0) {
+        splitLink->send(buf, size);
+        heartbeatTimer.restart();
+        coalescingStats.frames++;
+    }
+}
+
+static void sendSnapshot();
+
+// timeにpressedになった変化をまとめている変化に加える
+// フレームは変化ごとに順番と時刻を持つので、押した変化も同じIDが何度変わってもそのまままとめられる
+static void queueChanges(uint64_t pressed, Timestamp time) {
+    if (pressed == pressedIDs) {
+        return;
+    }
+    bool isQueued = encoder.hasChanges();
+    pressedIDs = pressed;
+    if (encoder.addChanges(pressed, time)) {
+        if (isQueued) {
+            coalescingStats.savedWrites++;
+        }
+        return;
+    }
+    // 1つのフレームに入りきらないので、それまでの分を先に送る
+    flushChanges();
+    if (encoder.addChanges(pressed, time) == false) {
+        // 1回に変わったIDが多すぎる
+        sendSnapshot();
+    }
+}
+
+static void sendSnapshot() {
+    // まとめている変化もpressedIDsに入っているので一緒に送られる
+    hasUnsentChanges = false;
+    coalescingTimer.stop();
+    uint8_t buf[SPLIT_FRAME_MAX_SIZE];
+    size_t size = encoder.encodeSnapshot(pressedIDs, timestamp(), buf);
+    splitLink->send(buf, size);
+    heartbeatTimer.restart();
+}
+
+static void sendTimeResponse() {
+    TimeSyncSample sample;
+    taskENTER_CRITICAL();
+    sample = timeSyncSample;
+    isTimeResponseRequested = false;
+    taskEXIT_CRITICAL();
+    // 受け取ってから返すまでの時間はマスター側で引かれるので、loopが遅れても結果はずれない
+    sample.responseTime = timestamp();
+    uint8_t buf[SPLIT_FRAME_MAX_SIZE];
+    size_t size = SplitFrameEncoder::encodeTimeResponse(sample, buf);
+    splitLink->send(buf, size);
+}
+
+// 一定間隔で押されているIDを全部送る
+class SnapshotTimer : public Timer {
+  public:
+    SnapshotTimer() : Timer(SNAPSHOT_INTERVAL, true) {
+    }
+
+    void start() {
+        startTimer();
+    }
+
+    void onTimer() override {
+        sendSnapshot();
+    }
+};
+
+static SnapshotTimer snapshotTimer;
+
+void startSplitSender(SplitLink &link, Timestamp (*now)()) {
+    splitLink = &link;
+    timestamp = now;
+    link.setReceiveCallback(receive_callback);
+    link.setConnectionCallback(connection_callback);
+    snapshotTimer.start();
+    heartbeatTimer.restart();
+}
+
+void sendKeyState(const KeyState &state) {
+    // 前回読んだ後に押して離されたキーは状態だけ送ると消えてしまうので、途中の状態を先に加える
+    if (state.bounced != 0) {
+        queueChanges(state.pressed ^ state.bounced, state.firstChangeTime);
+    }
+    queueChanges(state.pressed, state.time);
+    if (encoder.hasChanges() == false) {
+        return;
+    }
+    // 判断してから立てるまでの間に通知が来ても取りこぼさないように先に立てる
+    hasUnsentChanges = true;
+    Timestamp wait;
+    if (canDefer(timestamp(), wait)) {
+        // 接続イベントの直前の通知で送る、来なければ無線が動き出すはずの時刻に待つのをやめる
+        coalescingTimer.startAfter(wait + RadioNotification::LEAD_TIME);
+    } else {
+        flushChanges();
+    }
+}
+
+void processSplitRequests() {
+    // 接続イベントの直前の通知で起こされたらまとめた変化を送る
+    Timestamp wait;
+    if (hasUnsentChanges && canDefer(timestamp(), wait) == false) {
+        flushChanges();
+    }
+    if (isTimeResponseRequested) {
+        sendTimeResponse();
+    }
+    if (isSnapshotRequested) {
+        isSnapshotRequested = false;
+        sendSnapshot();
+        // 次の定期的なスナップショットは今から数える
+        snapshotTimer.start();
+    }
+}
+
+void connectionEventNotified(Timestamp time, BaseType_t *woken) {
+    lastNotificationTime = time;
+    hasNotified = true;
+    // まとめている変化があればloopTaskを起こして送る
+    if (hasUnsentChanges) {
+        wakeLoopTaskFromISR(woken);
+    }
+}
+
+void setConnectionInterval(uint16_t interval) {
+    connectionInterval = interval;
+}
+
+const TxCoalescingStats &txCoalescingStats() {
+    return coalescingStats;
+}
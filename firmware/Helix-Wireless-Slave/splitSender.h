@@ -0,0 +1,58 @@
+/*
+  The MIT License (MIT)
+
+  Copyright (c) 2018 ogatatsu.
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "KeyStateMailbox.h"
+#include "SplitLink.h"
+
+// マスター側に押されているIDを送る
+// linkの受け取りと接続のコールバックを設定して、定期的なスナップショットとハートビートのタイマーを開始する、loopTaskから1回だけ呼ぶ
+// フレームに入れる時刻はnowで読む、ホストのシミュレーターはマスター側とずらした時計を渡す
+void startSplitSender(SplitLink &link, Timestamp (*now)() = currentTimestamp);
+
+// 接続イベントまで待って変化をまとめた統計
+struct TxCoalescingStats {
+    uint32_t frames;      // 送った変化のフレーム
+    uint32_t savedWrites; // まとめたおかげで送らずに済んだフレーム
+    uint32_t fallbacks;   // 接続イベントの直前の通知が来ないので待つのをやめた回数
+};
+
+// loopTaskから、receiveKeyStateで読み出した変化を送る
+// 次の接続イベントまでに送れば間に合う時は、それまでの変化と変化した順番と時刻を残したまま1つのフレームにまとめる
+void sendKeyState(const KeyState &state);
+
+// loopTaskから、マスター側からの要求(スナップショット、時刻合わせ)があれば返事を送る
+// 接続イベントの直前の通知で起こされた時はまとめた変化を送る
+void processSplitRequests();
+
+// 無線の動作の通知の割り込みハンドラから、接続イベントの直前の通知が来たtime(startSplitSenderに渡した時計)を知らせる
+// まとめている変化があればloopTaskを起こす
+void connectionEventNotified(Timestamp time, BaseType_t *woken);
+
+// BLEのイベントから、マスター側との接続の接続間隔(1.25ms単位)を知らせる
+// スレーブレイテンシがある間と切断した時は0にする、0の間は変化をまとめずにすぐ送る
+void setConnectionInterval(uint16_t interval);
+
+const TxCoalescingStats &txCoalescingStats();